@@ -0,0 +1,71 @@
+#!/bin/sh
+# Load test of the render server: starts bin/main --serve, sends JOBS jobs
+# over CONCURRENCY connections (every scene at every resolution in turn,
+# pixels sent back over the socket) and prints p50/p99 latency and jobs/s.
+# For comparison it then times RUNS one-shot bin/main renders of the first
+# scene, which pay process start-up and scene loading every time.
+#
+#   scripts/loadtest.sh [scene.txt ...]
+#
+# Environment: JOBS (500), CONCURRENCY (4), THREADS (0 = all cores),
+# RESOLUTIONS ("64x64 96x72 128x96 160x120"), RUNS (20, 0 = no comparison).
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BIN="$ROOT/bin"
+JOBS=${JOBS:-500}
+CONCURRENCY=${CONCURRENCY:-4}
+THREADS=${THREADS:-0}
+RESOLUTIONS=${RESOLUTIONS:-"64x64 96x72 128x96 160x120"}
+RUNS=${RUNS:-20}
+SOCKET=${TMPDIR:-/tmp}/raytracer-loadtest-$$.sock
+
+if [ $# -eq 0 ]; then
+    set -- "$ROOT"/scene*.txt
+fi
+for tool in main render_client; do
+    if [ ! -x "$BIN/$tool" ]; then
+        echo "$BIN/$tool is missing; run make first" >&2
+        exit 1
+    fi
+done
+
+"$BIN/main" --serve "$SOCKET" --threads "$THREADS" > /dev/null &
+SERVER=$!
+trap 'kill $SERVER 2> /dev/null || true; rm -f "$SOCKET"' EXIT
+while [ ! -S "$SOCKET" ]; do
+    if ! kill -0 $SERVER 2> /dev/null; then
+        echo "The server did not start" >&2
+        exit 1
+    fi
+    sleep 0.05
+done
+
+RESOLUTION_ARGS=""
+for resolution in $RESOLUTIONS; do
+    RESOLUTION_ARGS="$RESOLUTION_ARGS --resolution $resolution"
+done
+
+echo "Render server, $JOBS jobs over $CONCURRENCY connections:"
+"$BIN/render_client" "$SOCKET" $RESOLUTION_ARGS --jobs "$JOBS" --concurrency "$CONCURRENCY" "$@"
+"$BIN/render_client" "$SOCKET" --stats
+"$BIN/render_client" "$SOCKET" --shutdown > /dev/null
+wait $SERVER
+trap - EXIT
+
+if [ "$RUNS" -gt 0 ]; then
+    resolution=${RESOLUTIONS%% *}
+    output=${TMPDIR:-/tmp}/raytracer-loadtest-$$.ppm
+    echo "One bin/main process per job, $RUNS renders of $1 at $resolution:"
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        start=$(date +%s%N)
+        "$BIN/main" "$1" "$output" --resolution "$resolution" --threads "$THREADS" > /dev/null
+        end=$(date +%s%N)
+        echo $(((end - start) / 1000))
+        i=$((i + 1))
+    done | sort -n | awk '{ v[NR] = $1 / 1000 }
+        END { p50 = int(NR * 0.5 + 0.999); p99 = int(NR * 0.99 + 0.999)
+              printf "latency ms: p50 %.2f, p99 %.2f, max %.2f\n", v[p50], v[p99], v[NR] }'
+    rm -f "$output"
+fi
@@ -0,0 +1,230 @@
+#include <BatchRender.h>
+#include <ThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <vector>
+
+namespace {
+    struct BatchEntry {
+        size_t scene{0};  // index into the distinct scenes
+        std::string output;
+        int width{0};
+        int height{0};
+        float aspect{0.0f};
+        std::optional<glm::vec3> eye;
+        std::optional<glm::vec3> up;
+        std::optional<glm::vec3> forward;
+        std::optional<glm::vec3> lookAt;
+        int line{0};
+    };
+
+    // "X,Y,Z"
+    bool parseVector(const std::string& text, glm::vec3& v)
+    {
+        std::string spaced = text;
+        std::replace(spaced.begin(), spaced.end(), ',', ' ');
+        std::istringstream in(spaced);
+        std::string rest;
+        return static_cast<bool>(in >> v.x >> v.y >> v.z) && !(in >> rest) &&
+               std::count(text.begin(), text.end(), ',') == 2;
+    }
+
+    std::string resolvePath(const std::string& directory, const std::string& path)
+    {
+        if (directory.empty() || path.empty() || path[0] == '/') {
+            return path;
+        }
+        return directory + "/" + path;
+    }
+
+    bool manifestError(const std::string& path, int line, const std::string& message)
+    {
+        std::cerr << path << ":" << line << ": " << message << std::endl;
+        return false;
+    }
+
+    // Fills the distinct scene paths and the entries, or reports the first error.
+    bool parseManifest(const BatchOptions& options, std::vector<std::string>& scenes,
+                       std::vector<BatchEntry>& entries)
+    {
+        const std::string& path = options.manifestPath;
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Failed to open manifest: " << path << std::endl;
+            return false;
+        }
+        const size_t slash = path.find_last_of('/');
+        const std::string directory = slash == std::string::npos ? std::string() : path.substr(0, slash);
+
+        std::map<std::string, size_t> sceneIndex;
+        std::string text;
+        for (int lineNumber = 1; std::getline(in, text); ++lineNumber) {
+            text = text.substr(0, text.find('#'));
+            std::istringstream fields(text);
+            std::string scene;
+            BatchEntry entry;
+            if (!(fields >> scene)) {
+                continue;
+            }
+            if (!(fields >> entry.output)) {
+                return manifestError(path, lineNumber, "expected SCENE OUTPUT [key=value...]");
+            }
+            entry.line = lineNumber;
+            entry.output = resolvePath(directory, entry.output);
+            entry.width = options.width;
+            entry.height = options.height;
+            entry.aspect = options.aspect;
+
+            std::string setting;
+            while (fields >> setting) {
+                const size_t equals = setting.find('=');
+                const std::string key = setting.substr(0, equals);
+                const std::string value = equals == std::string::npos ? std::string() : setting.substr(equals + 1);
+                glm::vec3 v{0.0f};
+                bool valid = true;
+                if (key == "resolution") {
+                    valid = parseResolution(value, entry.width, entry.height);
+                } else if (key == "aspect") {
+                    valid = parseAspect(value, entry.aspect);
+                } else if (key == "eye" || key == "up" || key == "forward" || key == "look-at") {
+                    valid = parseVector(value, v);
+                    (key == "eye" ? entry.eye : key == "up" ? entry.up : key == "forward" ? entry.forward
+                                                                                           : entry.lookAt) = v;
+                } else {
+                    return manifestError(path, lineNumber, "unknown setting: " + setting);
+                }
+                if (!valid) {
+                    return manifestError(path, lineNumber, "invalid value: " + setting);
+                }
+            }
+            if (entry.forward && entry.lookAt) {
+                return manifestError(path, lineNumber, "forward and look-at both set the view direction");
+            }
+            if (entry.height == 0) {
+                entry.height = entry.aspect > 0.0f
+                                   ? std::max(1, static_cast<int>(std::lround(entry.width / entry.aspect)))
+                                   : entry.width;
+            }
+
+            scene = resolvePath(directory, scene);
+            auto found = sceneIndex.emplace(scene, scenes.size());
+            if (found.second) {
+                scenes.push_back(scene);
+            }
+            entry.scene = found.first->second;
+            entries.push_back(entry);
+        }
+        return true;
+    }
+
+    // The scene's camera with the entry's overrides applied.
+    CameraParams entryCamera(const BatchEntry& entry, const CompiledScene& scene)
+    {
+        CameraParams camera = scene.cameraParams();
+        camera.eye = entry.eye.value_or(camera.eye);
+        camera.up = entry.up.value_or(camera.up);
+        camera.forward = entry.forward.value_or(camera.forward);
+        if (entry.lookAt) {
+            camera.forward = *entry.lookAt - camera.eye;
+        }
+        return camera;
+    }
+}
+
+int runBatch(const BatchOptions& options)
+{
+    std::vector<std::string> scenePaths;
+    std::vector<BatchEntry> entries;
+    if (!parseManifest(options, scenePaths, entries)) {
+        return 1;
+    }
+    if (entries.empty()) {
+        std::cerr << "No entries in " << options.manifestPath << std::endl;
+        return 1;
+    }
+
+    const int threadCount = options.settings.threadCount;
+    ThreadPool pool(threadCount > 0 ? static_cast<unsigned>(threadCount) : 0u);
+    const auto start = std::chrono::steady_clock::now();
+
+    // Every scene is parsed and compiled once, up front; the entries then
+    // share the compiled form, with their own resolution and camera.
+    std::vector<std::shared_ptr<const CompiledScene>> scenes(scenePaths.size());
+    pool.parallelFor(scenes.size(), [&](size_t i) {
+        try {
+            RayTracer loader(1, 1);
+            loader.setSceneDiskCache(options.diskCache);
+            if (loader.loadScene(scenePaths[i])) {
+                scenes[i] = loader.compiledScene();
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to load scene " << scenePaths[i] << ": " << e.what() << std::endl;
+        }
+    });
+    const auto loaded = std::chrono::steady_clock::now();
+
+    // One task per image; each image's tiles go to the same pool (a nested
+    // parallelFor), so idle workers pick up tiles of whatever is running.
+    std::mutex printMutex;
+    size_t finished = 0;
+    std::atomic<size_t> failures{0};
+    std::atomic<uint64_t> pixels{0};
+    pool.parallelFor(entries.size(), [&](size_t i) {
+        const BatchEntry& entry = entries[i];
+        const auto begin = std::chrono::steady_clock::now();
+        // An entry that throws (say, out of memory at a huge resolution) fails
+        // alone; the other entries and the summary carry on.
+        bool ok = false;
+        try {
+            if (scenes[entry.scene]) {
+                RayTracer tracer(entry.width, entry.height);
+                applyRenderSettings(options.settings, tracer);
+                tracer.setThreadPool(&pool);
+                tracer.setScreenAspect(entry.aspect);
+                tracer.setCompiledScene(scenes[entry.scene]);
+                if (entry.eye || entry.up || entry.forward || entry.lookAt) {
+                    tracer.setCamera(entryCamera(entry, *scenes[entry.scene]));
+                }
+                ok = renderToFile(tracer, entry.output, options.bandRows);
+                if (ok) {
+                    pixels += static_cast<uint64_t>(tracer.outputWidth()) * tracer.outputHeight();
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to render " << entry.output << ": " << e.what() << std::endl;
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        std::lock_guard<std::mutex> lock(printMutex);
+        ++finished;
+        if (!ok) {
+            ++failures;
+        }
+        std::cout << "[" << finished << "/" << entries.size() << "] " << (ok ? "" : "FAILED ")
+                  << scenePaths[entry.scene] << " -> " << entry.output << " (" << entry.width << "x" << entry.height
+                  << ", " << std::fixed << std::setprecision(1) << ms << " ms)" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    });
+
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    const size_t rendered = entries.size() - failures.load();
+    std::cout << std::fixed << std::setprecision(2) << "Rendered " << rendered << " of " << entries.size()
+              << " images in " << seconds << " s: " << rendered / seconds << " images/s, "
+              << static_cast<double>(pixels.load()) / 1e6 / seconds << " Mpixel/s (" << scenePaths.size()
+              << " scenes loaded in " << std::chrono::duration<double, std::milli>(loaded - start).count()
+              << " ms, " << pool.size() << " threads)" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    return failures.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <RenderCli.h>
+
+#include <string>
+
+// Batch mode (bin/main --batch MANIFEST): renders every entry of a manifest
+// in one process. Each distinct scene is loaded and compiled once, however
+// many entries use it, and all images are scheduled onto one thread pool:
+// whole images run side by side and their tiles are shared out on the same
+// workers, so small images keep every core busy.
+//
+// A manifest has one entry per line; blank lines and everything after a '#'
+// are ignored. Relative paths are relative to the manifest's directory:
+//
+//   SCENE OUTPUT [resolution=W|WxH] [aspect=W:H|R] [eye=X,Y,Z] [up=X,Y,Z]
+//                [forward=X,Y,Z] [look-at=X,Y,Z]
+//
+// The output format follows the extension, as on the command line. The
+// camera keys replace that part of the scene's camera (look-at sets forward
+// towards a point); resolution and aspect default to the command line's.
+struct BatchOptions {
+    std::string manifestPath;
+    RenderSettings settings{};  // threadCount sizes the shared pool
+    int width{1000};
+    int height{0};              // 0 = from the width and the aspect
+    float aspect{0.0f};
+    int bandRows{0};
+    std::shared_ptr<SceneDiskCache> diskCache;  // may be null
+};
+
+// Renders the manifest; returns the process exit code (1 if any entry failed).
+int runBatch(const BatchOptions& options);
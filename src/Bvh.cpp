@@ -0,0 +1,157 @@
+#include <Bvh.h>
+
+#include <algorithm>
+
+namespace {
+    constexpr int kBinCount = 16;
+    constexpr uint32_t kMaxLeafSize = 4;
+    constexpr float kTraversalCost = 1.0f;   // relative to one primitive test
+
+    struct Bin {
+        Aabb bounds;
+        uint32_t count{0};
+    };
+
+    // Grow node boxes by a hair so rays that graze a primitive exactly on its
+    // box face are not lost to rounding in the slab test.
+    Aabb padded(const Aabb& b)
+    {
+        glm::vec3 extent = b.max - b.min;
+        glm::vec3 pad = 1e-5f * glm::max(extent, glm::vec3(glm::max(glm::abs(b.min), glm::abs(b.max)))) + 1e-7f;
+        return {b.min - pad, b.max + pad};
+    }
+}
+
+void Bvh::clear()
+{
+    m_Nodes.clear();
+    m_PrimIndices.clear();
+}
+
+void Bvh::build(const std::vector<Aabb>& primBounds)
+{
+    clear();
+    const uint32_t primCount = static_cast<uint32_t>(primBounds.size());
+    if (primCount == 0) {
+        return;
+    }
+
+    std::vector<glm::vec3> centroids(primCount);
+    m_PrimIndices.resize(primCount);
+    for (uint32_t i = 0; i < primCount; ++i) {
+        m_PrimIndices[i] = i;
+        centroids[i] = primBounds[i].centroid();
+    }
+
+    m_Nodes.reserve(2 * static_cast<size_t>(primCount));
+    m_Nodes.push_back({});
+    m_Nodes[0].leftOrFirst = 0;
+    m_Nodes[0].primCount = primCount;
+
+    struct Pending {
+        uint32_t node;
+        int depth;
+    };
+    std::vector<Pending> work{{0, 0}};
+
+    while (!work.empty()) {
+        Pending item = work.back();
+        work.pop_back();
+
+        const uint32_t first = m_Nodes[item.node].leftOrFirst;
+        const uint32_t count = m_Nodes[item.node].primCount;
+
+        Aabb bounds;
+        Aabb centroidBounds;
+        for (uint32_t i = first; i < first + count; ++i) {
+            bounds.grow(primBounds[m_PrimIndices[i]]);
+            centroidBounds.grow(centroids[m_PrimIndices[i]]);
+        }
+        Aabb box = padded(bounds);
+        m_Nodes[item.node].boundsMin = box.min;
+        m_Nodes[item.node].boundsMax = box.max;
+
+        // Traversal stacks are fixed size; past this depth we accept fat leaves.
+        if (count <= 1 || item.depth >= kMaxDepth - 2) {
+            continue;
+        }
+
+        // Binned SAH: evaluate kBinCount - 1 planes per axis over centroid bounds.
+        int bestAxis = -1;
+        int bestSplit = 0;
+        float bestCost = std::numeric_limits<float>::infinity();
+        for (int axis = 0; axis < 3; ++axis) {
+            float lo = centroidBounds.min[axis];
+            float hi = centroidBounds.max[axis];
+            if (!(hi > lo)) {
+                continue;
+            }
+
+            Bin bins[kBinCount];
+            float scale = kBinCount / (hi - lo);
+            for (uint32_t i = first; i < first + count; ++i) {
+                uint32_t prim = m_PrimIndices[i];
+                int b = std::min(kBinCount - 1, static_cast<int>((centroids[prim][axis] - lo) * scale));
+                bins[b].count++;
+                bins[b].bounds.grow(primBounds[prim]);
+            }
+
+            float leftArea[kBinCount - 1];
+            uint32_t leftCount[kBinCount - 1];
+            Aabb acc;
+            uint32_t sum = 0;
+            for (int i = 0; i < kBinCount - 1; ++i) {
+                sum += bins[i].count;
+                acc.grow(bins[i].bounds);
+                leftCount[i] = sum;
+                leftArea[i] = acc.area();
+            }
+            acc = Aabb{};
+            sum = 0;
+            for (int i = kBinCount - 1; i > 0; --i) {
+                sum += bins[i].count;
+                acc.grow(bins[i].bounds);
+                if (leftCount[i - 1] == 0 || sum == 0) {
+                    continue;
+                }
+                float cost = leftCount[i - 1] * leftArea[i - 1] + sum * acc.area();
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        if (bestAxis < 0) {
+            continue;  // all centroids coincide
+        }
+        float leafCost = count * bounds.area();
+        float splitCost = kTraversalCost * bounds.area() + bestCost;
+        if (count <= kMaxLeafSize && splitCost >= leafCost) {
+            continue;
+        }
+
+        float lo = centroidBounds.min[bestAxis];
+        float scale = kBinCount / (centroidBounds.max[bestAxis] - lo);
+        auto middle = std::partition(m_PrimIndices.begin() + first, m_PrimIndices.begin() + first + count,
+            [&](uint32_t prim) {
+                int b = std::min(kBinCount - 1, static_cast<int>((centroids[prim][bestAxis] - lo) * scale));
+                return b < bestSplit;
+            });
+        uint32_t leftCountFinal = static_cast<uint32_t>(middle - (m_PrimIndices.begin() + first));
+
+        uint32_t leftChild = static_cast<uint32_t>(m_Nodes.size());
+        m_Nodes.push_back({});
+        m_Nodes.push_back({});
+        m_Nodes[leftChild].leftOrFirst = first;
+        m_Nodes[leftChild].primCount = leftCountFinal;
+        m_Nodes[leftChild + 1].leftOrFirst = first + leftCountFinal;
+        m_Nodes[leftChild + 1].primCount = count - leftCountFinal;
+        m_Nodes[item.node].leftOrFirst = leftChild;
+        m_Nodes[item.node].primCount = 0;
+
+        work.push_back({leftChild, item.depth + 1});
+        work.push_back({leftChild + 1, item.depth + 1});
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+struct Aabb {
+    glm::vec3 min{std::numeric_limits<float>::infinity()};
+    glm::vec3 max{-std::numeric_limits<float>::infinity()};
+
+    void grow(const glm::vec3& p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    void grow(const Aabb& b)
+    {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+    bool valid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+    float area() const
+    {
+        glm::vec3 e = max - min;
+        return valid() ? 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x) : 0.0f;
+    }
+    glm::vec3 centroid() const { return 0.5f * (min + max); }
+};
+
+// 32-byte node. Interior nodes store the index of their left child (the right
+// child follows it); leaves store a range into the primitive index list.
+struct BvhNode {
+    glm::vec3 boundsMin{0.0f};
+    uint32_t leftOrFirst{0};
+    glm::vec3 boundsMax{0.0f};
+    uint32_t primCount{0};  // 0 for interior nodes
+
+    bool isLeaf() const { return primCount != 0; }
+};
+
+// Bounding volume hierarchy over a set of primitive bounds, built with a
+// binned surface area heuristic. It only knows boxes; the per-ISA kernels
+// (Kernels.h) traverse it and test the primitives themselves.
+class Bvh {
+  public:
+    // Deepest node is kMaxDepth - 2, so the kernels' fixed traversal stacks never overflow.
+    static constexpr int kMaxDepth = 64;
+
+    void build(const std::vector<Aabb>& primBounds);
+    void clear();
+
+    bool empty() const { return m_Nodes.empty(); }
+    const std::vector<BvhNode>& nodes() const { return m_Nodes; }
+    const std::vector<uint32_t>& primIndices() const { return m_PrimIndices; }
+
+  private:
+    std::vector<BvhNode> m_Nodes;
+    std::vector<uint32_t> m_PrimIndices;
+};
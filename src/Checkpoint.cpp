@@ -0,0 +1,158 @@
+#include <Checkpoint.h>
+#include <Hash.h>
+#include <MappedFile.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+#include <vector>
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "tiles are stored as packed RGB floats");
+
+namespace {
+    constexpr uint32_t kByteOrder = 0x01020304;
+
+    bool sameKey(const CheckpointKey& a, const CheckpointKey& b)
+    {
+        return a.sceneFingerprint == b.sceneFingerprint && a.width == b.width && a.height == b.height &&
+               a.tileSize == b.tileSize && a.maxDepth == b.maxDepth;
+    }
+
+    uint64_t recordSeed(const CheckpointTileHeader& record)
+    {
+        return hashBytes(&record, offsetof(CheckpointTileHeader, hash));
+    }
+}
+
+bool loadCheckpoint(const std::string& path, const CheckpointKey& key, uint32_t tileCount,
+                    const CheckpointTileFn& restore, uint64_t& validBytes)
+{
+    validBytes = 0;
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    CheckpointHeader header;
+    if (file.size() < sizeof(header)) {
+        std::cerr << path << ": not a render checkpoint" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kCheckpointMagic, sizeof(kCheckpointMagic)) != 0 ||
+        header.version != kCheckpointVersion || header.byteOrder != kByteOrder) {
+        std::cerr << path << ": not a render checkpoint of this version and platform" << std::endl;
+        return false;
+    }
+    if (!sameKey(header.key, key) || header.tileCount != tileCount) {
+        std::cerr << path << ": checkpoint is for a different scene or render settings; starting over" << std::endl;
+        return false;
+    }
+
+    // Header and records are whole multiples of 4 bytes, so the floats of
+    // every record are aligned and read in place.
+    static_assert(sizeof(CheckpointHeader) % alignof(glm::vec3) == 0, "tile records must stay aligned");
+    static_assert(sizeof(CheckpointTileHeader) % alignof(glm::vec3) == 0, "tile records must stay aligned");
+    uint64_t offset = sizeof(header);
+    while (file.size() - offset >= sizeof(CheckpointTileHeader)) {
+        CheckpointTileHeader record;
+        std::memcpy(&record, file.data() + offset, sizeof(record));
+        const uint64_t bytes = static_cast<uint64_t>(record.pixelCount) * sizeof(glm::vec3);
+        if (record.tile >= tileCount || bytes > file.size() - offset - sizeof(record)) {
+            break;
+        }
+        const char* data = file.data() + offset + sizeof(record);
+        if (hashBytes(data, bytes, recordSeed(record)) != record.hash) {
+            break;
+        }
+        if (!restore(record.tile, reinterpret_cast<const glm::vec3*>(data), record.pixelCount)) {
+            break;
+        }
+        offset += sizeof(record) + bytes;
+    }
+    if (offset != file.size()) {
+        std::cerr << path << ": dropping " << file.size() - offset << " bytes of incomplete tiles" << std::endl;
+    }
+    validBytes = offset;
+    return true;
+}
+
+bool CheckpointWriter::open(const std::string& path, const CheckpointKey& key, uint32_t tileCount,
+                            uint64_t keepBytes, double flushSeconds)
+{
+    m_Path = path;
+    m_FlushSeconds = flushSeconds;
+    m_LastFlush = std::chrono::steady_clock::now();
+    m_TilesWritten = 0;
+    m_Failed = false;
+    if (keepBytes > 0) {
+        // Cut off a torn last record before appending after it.
+        std::error_code error;
+        std::filesystem::resize_file(path, keepBytes, error);
+        if (!error) {
+            m_Out.open(path, std::ios::binary | std::ios::app);
+            if (m_Out.is_open()) {
+                return true;
+            }
+        }
+    }
+
+    CheckpointHeader header{};
+    std::memcpy(header.magic, kCheckpointMagic, sizeof(kCheckpointMagic));
+    header.version = kCheckpointVersion;
+    header.byteOrder = kByteOrder;
+    header.key = key;
+    header.tileCount = tileCount;
+    m_Out.open(path, std::ios::binary | std::ios::trunc);
+    m_Out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!m_Out.flush()) {
+        std::cerr << "Failed to write checkpoint " << path << std::endl;
+        m_Out.close();
+        m_Failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool CheckpointWriter::append(uint32_t tile, const glm::vec3* pixels, int width, int height, size_t stride)
+{
+    CheckpointTileHeader record{};
+    record.tile = tile;
+    record.pixelCount = static_cast<uint32_t>(width) * static_cast<uint32_t>(height);
+    // Gathered and hashed outside the lock; only the write is serialized.
+    std::vector<glm::vec3> gathered(record.pixelCount);
+    for (int y = 0; y < height; ++y) {
+        std::copy(pixels + y * stride, pixels + y * stride + width, gathered.begin() + static_cast<size_t>(y) * width);
+    }
+    const size_t bytes = gathered.size() * sizeof(glm::vec3);
+    record.hash = hashBytes(gathered.data(), bytes, recordSeed(record));
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_Failed) {
+        return false;
+    }
+    m_Out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    m_Out.write(reinterpret_cast<const char*>(gathered.data()), static_cast<std::streamsize>(bytes));
+    const auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - m_LastFlush).count() >= m_FlushSeconds) {
+        m_Out.flush();
+        m_LastFlush = now;
+    }
+    if (!m_Out) {
+        std::cerr << "Failed to write checkpoint " << m_Path << "; rendering on without it" << std::endl;
+        m_Failed = true;
+        return false;
+    }
+    ++m_TilesWritten;
+    return true;
+}
+
+void CheckpointWriter::close()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_Out.is_open()) {
+        m_Out.close();
+    }
+}
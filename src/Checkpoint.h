@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Render checkpoint file: the finished tiles of a frame, appended as they
+// finish. Native byte order:
+//
+//   CheckpointHeader
+//   tile record     CheckpointTileHeader, then pixelCount RGB floats of the
+//   ...             tile, row-major from its top row
+//
+// Only finished tiles are stored, each once, so the file grows with the work
+// done instead of being rewritten whole. A crash mid-append leaves a short or
+// torn last record; its hash does not match, so it and anything after it are
+// dropped on load and overwritten when the render resumes.
+
+constexpr char kCheckpointMagic[8] = {'R', 'T', 'C', 'K', 'P', 'T', '\0', '\0'};
+constexpr uint32_t kCheckpointVersion = 2;
+
+// Everything a checkpoint must agree on to be resumed: the same scene
+// content, the same tiling of the same frame, and the same path cut-off.
+struct CheckpointKey {
+    uint64_t sceneFingerprint{0};  // CompiledScene::fingerprint
+    int32_t width{0};
+    int32_t height{0};
+    int32_t tileSize{0};
+    int32_t maxDepth{0};
+};
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;  // 0x01020304 as written
+    CheckpointKey key;
+    uint32_t tileCount;
+    uint32_t reserved;
+};
+
+struct CheckpointTileHeader {
+    uint32_t tile;        // index into the frame's tiles
+    uint32_t pixelCount;  // width * height of that tile
+    uint64_t hash;        // hashBytes of this header's first 8 bytes, then of the pixels
+};
+
+// Receives one stored tile; returns false when the record does not fit the
+// tile (which ends the usable part of the file).
+using CheckpointTileFn = std::function<bool(uint32_t tile, const glm::vec3* pixels, uint32_t pixelCount)>;
+
+// Hands every intact tile of a checkpoint written for key to restore and sets
+// validBytes to the length of the file up to the last of them. Returns false
+// when there is no checkpoint at path; a checkpoint for another key is
+// reported and ignored.
+bool loadCheckpoint(const std::string& path, const CheckpointKey& key, uint32_t tileCount,
+                    const CheckpointTileFn& restore, uint64_t& validBytes);
+
+// Appends finished tiles to a checkpoint file. Safe to call from the render
+// threads: records are written whole under a lock.
+class CheckpointWriter {
+  public:
+    // Starts a new file at path, or continues the first keepBytes of the one
+    // there (as reported by loadCheckpoint) when keepBytes is nonzero.
+    bool open(const std::string& path, const CheckpointKey& key, uint32_t tileCount, uint64_t keepBytes,
+              double flushSeconds);
+    // Stores rows of width pixels, stride pixels apart, as tile's record.
+    // After a write error the writer reports once and stores nothing more.
+    bool append(uint32_t tile, const glm::vec3* pixels, int width, int height, size_t stride);
+    void close();
+
+    size_t tilesWritten() const { return m_TilesWritten; }
+
+  private:
+    std::mutex m_Mutex;
+    std::ofstream m_Out;
+    std::string m_Path;
+    double m_FlushSeconds{0.0};
+    std::chrono::steady_clock::time_point m_LastFlush;
+    size_t m_TilesWritten{0};
+    bool m_Failed{false};
+};
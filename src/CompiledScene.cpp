@@ -0,0 +1,60 @@
+#include <CompiledScene.h>
+#include <RayTracer.h>
+
+#include <cmath>
+
+namespace {
+    // v * (1 / |v|), the normalization the light loop used to redo at every hit.
+    glm::vec3 unitVector(const glm::vec3& v)
+    {
+        float inv = 1.0f / std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+        return {v.x * inv, v.y * inv, v.z * inv};
+    }
+}
+
+CompiledCamera compileCamera(const CameraParams& params, int width, int height)
+{
+    CompiledCamera camera;
+    camera.eye = params.eye;
+    camera.forward = glm::normalize(params.forward);
+    camera.right = glm::normalize(glm::cross(camera.forward, params.up));
+    camera.up = glm::normalize(glm::cross(camera.right, camera.forward));
+    camera.screenCenter = params.eye + camera.forward * params.screenDistance;
+    camera.width = width;
+    camera.height = height;
+
+    camera.columnPoint.resize(width);
+    for (int x = 0; x < width; ++x) {
+        float px = ((static_cast<float>(x) + 0.5f) / static_cast<float>(width) - 0.5f) * params.screenWidth;
+        camera.columnPoint[x] = camera.screenCenter + camera.right * px;
+    }
+    camera.rowOffset.resize(height);
+    for (int y = 0; y < height; ++y) {
+        float py = (0.5f - (static_cast<float>(y) + 0.5f) / static_cast<float>(height)) * params.screenHeight;
+        camera.rowOffset[y] = camera.up * py;
+    }
+    return camera;
+}
+
+std::shared_ptr<const CompiledScene> CompiledScene::compile(const Scene& scene)
+{
+    std::shared_ptr<CompiledScene> compiled(new CompiledScene());
+    SceneGeometry& geometry = compiled->m_Geometry;
+
+    for (uint32_t i = 0; i < scene.objects.size(); ++i) {
+        scene.objects[i]->flatten(geometry, i);
+    }
+    for (const Light& light : scene.lights) {
+        // Spotlights keep their cone axis; directional lights store the
+        // direction toward the light, which is what the shading loop uses.
+        glm::vec3 direction = light.isSpot ? unitVector(light.direction) : unitVector(-light.direction);
+        geometry.addLight(direction, light.position, light.intensity, light.isSpot, light.cutoff);
+    }
+    geometry.buildBvh();
+
+    compiled->m_GeometryView = makeGeometryView(geometry);
+    compiled->m_LightView = makeLightView(geometry.lights);
+    compiled->m_CameraParams = scene.camera;
+    compiled->m_Ambient = scene.ambient;
+    return compiled;
+}
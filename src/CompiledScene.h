@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Geometry.h>
+#include <Kernels.h>
+#include <MappedFile.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Scene;
+
+// Camera frame plus per-column and per-row tables for one output resolution.
+// A camera ray is columnPoint[x] + rowOffset[y] - eye, normalized: the same
+// additions, in the same order, as evaluating the screen point per pixel.
+struct CompiledCamera {
+    glm::vec3 eye{0.0f};
+    glm::vec3 forward{0.0f};
+    glm::vec3 right{0.0f};
+    glm::vec3 up{0.0f};
+    glm::vec3 screenCenter{0.0f};
+    int width{0};
+    int height{0};
+    std::vector<glm::vec3> columnPoint;  // screenCenter + right * px
+    std::vector<glm::vec3> rowOffset;    // up * py
+
+    Ray ray(int x, int y) const { return {eye, glm::normalize(columnPoint[x] + rowOffset[y] - eye)}; }
+};
+
+CompiledCamera compileCamera(const CameraParams& params, int width, int height);
+
+// Immutable, render-ready form of a Scene: flattened primitives, the material
+// table, the BVH, lights with their per-hit invariants folded in, and the
+// camera parameters. Nothing in it depends on the output resolution: each
+// render compiles the camera for its own. The render engines read nothing
+// else, and only through the views, so the arrays may live in owned vectors
+// (compile) or straight in a mapped binary scene file (loadBinary, see
+// SceneFile.h).
+class CompiledScene {
+  public:
+    static std::shared_ptr<const CompiledScene> compile(const Scene& scene);
+
+    // Maps a file written by writeBinary and renders from it in place. A BVH
+    // is only built when the file was written without one.
+    static std::shared_ptr<const CompiledScene> loadBinary(const std::string& path);
+    static std::shared_ptr<const CompiledScene> loadBinary(MappedFile file, const std::string& path);
+    bool writeBinary(const std::string& path, bool withBvh) const;
+    // Hash of everything that decides the rendered image (primitives,
+    // materials, lights, camera, ambient) but not of the BVH or of the form
+    // the scene was loaded from: a text scene and its binary conversion agree.
+    uint64_t fingerprint() const;
+
+    CompiledScene(const CompiledScene&) = delete;
+    CompiledScene& operator=(const CompiledScene&) = delete;
+
+    const Material& material(uint32_t index) const { return m_GeometryView.materials[index]; }
+    const GeometryView& geometryView() const { return m_GeometryView; }
+    const LightView& lightView() const { return m_LightView; }
+    const CameraParams& cameraParams() const { return m_CameraParams; }
+    const glm::vec3& ambient() const { return m_Ambient; }
+
+  private:
+    CompiledScene() = default;
+
+    SceneGeometry m_Geometry;  // storage of compiled scenes
+    MappedFile m_File;         // storage of loaded binary scenes
+    Bvh m_FileBvh;             // built at load time for files without one
+    GeometryView m_GeometryView{};  // points into m_Geometry or m_File
+    LightView m_LightView{};
+    CameraParams m_CameraParams;
+    glm::vec3 m_Ambient{0.0f};
+};
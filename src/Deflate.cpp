@@ -0,0 +1,419 @@
+#include <Deflate.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    constexpr int kMinMatch = 3;
+    constexpr int kMaxMatch = 258;
+    constexpr size_t kTooFar = 4096;     // a 3-byte match further back costs more than three literals
+    constexpr size_t kMaxStoredBlock = 65535;
+    constexpr int kHashBits = 15;
+    constexpr size_t kHashSize = size_t(1) << kHashBits;
+    constexpr size_t kWindowMask = kDeflateWindow - 1;
+
+    constexpr uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                          31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    constexpr uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                          2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    constexpr uint16_t kDistanceBase[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                            33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                            1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+    constexpr uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                            6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    // Match search effort per level, after zlib's configuration table.
+    struct LevelParams {
+        int maxChain;   // hash chain entries tried per position
+        int lazyLimit;  // matches this long are taken without looking one byte ahead; 0 = greedy
+        int niceLength; // stop searching once a match is this long
+    };
+
+    constexpr LevelParams kLevels[kDeflateMaxLevel + 1] = {
+        {0, 0, 0},            // 0: stored
+        {4, 0, 8},            // 1
+        {8, 0, 16},           // 2
+        {32, 0, 32},          // 3
+        {16, 4, 16},          // 4
+        {32, 16, 32},         // 5
+        {128, 16, 128},       // 6
+        {256, 32, 128},       // 7
+        {1024, 128, 258},     // 8
+        {4096, 258, 258},     // 9
+    };
+
+    uint32_t reverseBits(uint32_t code, int bits)
+    {
+        uint32_t reversed = 0;
+        for (int i = 0; i < bits; ++i) {
+            reversed = (reversed << 1) | ((code >> i) & 1u);
+        }
+        return reversed;
+    }
+
+    // Fixed Huffman codes (stored bit-reversed, ready for the LSB-first bit
+    // writer), symbol lookups and the CRC table, built once.
+    struct Tables {
+        uint16_t literalCode[288];
+        uint8_t literalBits[288];
+        uint8_t distanceCode[30];
+        uint8_t lengthSymbol[kMaxMatch + 1];
+        uint8_t distanceSymbol[512];  // zlib's split lookup, see distanceSymbolOf
+        uint32_t crc[256];
+
+        Tables()
+        {
+            for (int v = 0; v < 288; ++v) {
+                uint32_t code = 0;
+                int bits = 0;
+                if (v < 144) {
+                    code = 0x30 + v;
+                    bits = 8;
+                } else if (v < 256) {
+                    code = 0x190 + (v - 144);
+                    bits = 9;
+                } else if (v < 280) {
+                    code = v - 256;
+                    bits = 7;
+                } else {
+                    code = 0xC0 + (v - 280);
+                    bits = 8;
+                }
+                literalCode[v] = static_cast<uint16_t>(reverseBits(code, bits));
+                literalBits[v] = static_cast<uint8_t>(bits);
+            }
+            for (int d = 0; d < 30; ++d) {
+                distanceCode[d] = static_cast<uint8_t>(reverseBits(d, 5));
+            }
+            for (int s = 0; s < 29; ++s) {
+                int count = s == 28 ? 1 : 1 << kLengthExtra[s];
+                for (int i = 0; i < count; ++i) {
+                    lengthSymbol[kLengthBase[s] + i] = static_cast<uint8_t>(s);
+                }
+            }
+            for (int s = 0; s < 30; ++s) {
+                for (uint32_t d = kDistanceBase[s]; d < kDistanceBase[s] + (1u << kDistanceExtra[s]); ++d) {
+                    distanceSymbol[d <= 256 ? d - 1 : 256 + ((d - 1) >> 7)] = static_cast<uint8_t>(s);
+                }
+            }
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                crc[n] = c;
+            }
+        }
+
+        uint8_t distanceSymbolOf(size_t distance) const
+        {
+            return distance <= 256 ? distanceSymbol[distance - 1] : distanceSymbol[256 + ((distance - 1) >> 7)];
+        }
+    };
+
+    const Tables& tables()
+    {
+        static const Tables instance;
+        return instance;
+    }
+
+    class BitWriter {
+      public:
+        explicit BitWriter(std::vector<uint8_t>& out) : m_Out(out) {}
+
+        // count <= 16
+        void put(uint32_t bits, int count)
+        {
+            m_Bits |= static_cast<uint64_t>(bits) << m_Count;
+            m_Count += count;
+            if (m_Count >= 32) {
+                uint8_t bytes[4] = {static_cast<uint8_t>(m_Bits), static_cast<uint8_t>(m_Bits >> 8),
+                                    static_cast<uint8_t>(m_Bits >> 16), static_cast<uint8_t>(m_Bits >> 24)};
+                m_Out.insert(m_Out.end(), bytes, bytes + 4);
+                m_Bits >>= 32;
+                m_Count -= 32;
+            }
+        }
+
+        void alignToByte()
+        {
+            while (m_Count > 0) {
+                m_Out.push_back(static_cast<uint8_t>(m_Bits));
+                m_Bits >>= 8;
+                m_Count = m_Count > 8 ? m_Count - 8 : 0;
+            }
+            m_Bits = 0;
+        }
+
+      private:
+        std::vector<uint8_t>& m_Out;
+        uint64_t m_Bits{0};
+        int m_Count{0};
+    };
+
+    uint32_t hashAt(const uint8_t* p)
+    {
+        uint32_t v = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+        return (v * 2654435761u) >> (32 - kHashBits);
+    }
+
+    int commonLength(const uint8_t* a, const uint8_t* b, int maxLength)
+    {
+        int length = 0;
+        while (length + 8 <= maxLength) {
+            uint64_t x = 0;
+            uint64_t y = 0;
+            std::memcpy(&x, a + length, 8);
+            std::memcpy(&y, b + length, 8);
+            if (x != y) {
+                return length + __builtin_ctzll(x ^ y) / 8;  // little-endian byte order
+            }
+            length += 8;
+        }
+        while (length < maxLength && a[length] == b[length]) {
+            ++length;
+        }
+        return length;
+    }
+
+    class MatchFinder {
+      public:
+        MatchFinder(const uint8_t* buffer, size_t end, const LevelParams& params)
+            : m_Buffer(buffer), m_End(end), m_MaxChain(params.maxChain), m_NiceLength(params.niceLength),
+              m_Head(kHashSize, -1), m_Prev(kDeflateWindow, -1)
+        {}
+
+        void insert(size_t pos)
+        {
+            if (pos + kMinMatch <= m_End) {
+                uint32_t h = hashAt(m_Buffer + pos);
+                m_Prev[pos & kWindowMask] = m_Head[h];
+                m_Head[h] = static_cast<int32_t>(pos);
+            }
+        }
+
+        // Longest match for pos that beats minLength, or 0. pos itself must
+        // not be inserted yet.
+        int find(size_t pos, int minLength, size_t& distance) const
+        {
+            const int maxLength = static_cast<int>(std::min<size_t>(kMaxMatch, m_End - pos));
+            const int niceLength = std::min(m_NiceLength, maxLength);
+            if (maxLength < kMinMatch || minLength >= maxLength) {
+                return 0;
+            }
+            const uint8_t* target = m_Buffer + pos;
+            const size_t limit = pos > kDeflateWindow ? pos - kDeflateWindow : 0;
+            int best = std::max(minLength, kMinMatch - 1);
+            int32_t candidate = m_Head[hashAt(target)];
+            for (int chain = m_MaxChain; candidate >= 0 && static_cast<size_t>(candidate) >= limit && chain > 0;
+                 --chain) {
+                const uint8_t* match = m_Buffer + candidate;
+                if (match[best] == target[best] && match[0] == target[0] && match[1] == target[1]) {
+                    int length = commonLength(match, target, maxLength);
+                    if (length > best) {
+                        best = length;
+                        distance = pos - static_cast<size_t>(candidate);
+                        if (length >= niceLength) {
+                            break;
+                        }
+                    }
+                }
+                int32_t next = m_Prev[static_cast<size_t>(candidate) & kWindowMask];
+                if (next >= candidate) {
+                    break;  // slot already reused by a newer position
+                }
+                candidate = next;
+            }
+            if (best == kMinMatch && distance > kTooFar) {
+                return 0;
+            }
+            return best > minLength && best >= kMinMatch ? best : 0;
+        }
+
+      private:
+        const uint8_t* m_Buffer;
+        size_t m_End;
+        int m_MaxChain;
+        int m_NiceLength;
+        std::vector<int32_t> m_Head;
+        std::vector<int32_t> m_Prev;
+    };
+
+    // Level 0. Stored blocks end byte aligned, so no sync flush is needed.
+    void storeChunk(const uint8_t* data, size_t size, bool final, std::vector<uint8_t>& out)
+    {
+        size_t offset = 0;
+        do {
+            const size_t length = std::min(kMaxStoredBlock, size - offset);
+            const bool last = offset + length == size;
+            const uint8_t header[5] = {static_cast<uint8_t>(final && last ? 1 : 0),  // BFINAL, BTYPE 00
+                                       static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8),
+                                       static_cast<uint8_t>(~length), static_cast<uint8_t>(~length >> 8)};
+            out.insert(out.end(), header, header + 5);
+            out.insert(out.end(), data + offset, data + offset + length);
+            offset += length;
+        } while (offset < size);
+    }
+}
+
+uint8_t zlibHeaderFlags(int level)
+{
+    // FLEVEL hint plus the check bits that make 0x78xx a multiple of 31.
+    return level <= 1 ? 0x01 : level <= 5 ? 0x5E : level == 6 ? 0x9C : 0xDA;
+}
+
+void deflateChunk(const uint8_t* buffer, size_t dictionarySize, size_t size, bool final, int level,
+                  std::vector<uint8_t>& out)
+{
+    level = std::max(kDeflateMinLevel, std::min(level, kDeflateMaxLevel));
+    if (level == 0) {
+        storeChunk(buffer + dictionarySize, size, final, out);
+        return;
+    }
+    const LevelParams& params = kLevels[level];
+
+    const Tables& t = tables();
+    const size_t end = dictionarySize + size;
+    MatchFinder finder(buffer, end, params);
+    for (size_t pos = dictionarySize > kDeflateWindow ? dictionarySize - kDeflateWindow : 0; pos < dictionarySize;
+         ++pos) {
+        finder.insert(pos);
+    }
+
+    BitWriter bits(out);
+    auto literal = [&](uint8_t value) { bits.put(t.literalCode[value], t.literalBits[value]); };
+    auto match = [&](int length, size_t distance) {
+        int ls = t.lengthSymbol[length];
+        bits.put(t.literalCode[257 + ls], t.literalBits[257 + ls]);
+        if (kLengthExtra[ls] != 0) {
+            bits.put(length - kLengthBase[ls], kLengthExtra[ls]);
+        }
+        int ds = t.distanceSymbolOf(distance);
+        bits.put(t.distanceCode[ds], 5);
+        if (kDistanceExtra[ds] != 0) {
+            bits.put(static_cast<uint32_t>(distance - kDistanceBase[ds]), kDistanceExtra[ds]);
+        }
+    };
+
+    // One fixed-Huffman block for the whole chunk.
+    bits.put(final ? 1 : 0, 1);
+    bits.put(1, 2);
+
+    size_t pos = dictionarySize;
+    while (params.lazyLimit == 0 && pos < end) {
+        // Greedy: take the first match found.
+        size_t distance = 0;
+        const int length = finder.find(pos, 0, distance);
+        finder.insert(pos);
+        if (length == 0) {
+            literal(buffer[pos++]);
+            continue;
+        }
+        match(length, distance);
+        for (size_t p = pos + 1; p < pos + length; ++p) {
+            finder.insert(p);
+        }
+        pos += length;
+    }
+
+    // Lazy matching as in zlib: a match found at pos is only emitted when the
+    // match starting one byte later is no longer.
+    bool pending = false;  // buffer[pos - 1] not emitted yet
+    int pendingLength = 0;
+    size_t pendingDistance = 0;
+    while (pos < end) {
+        size_t distance = 0;
+        int length = pendingLength < params.lazyLimit ? finder.find(pos, pendingLength, distance) : 0;
+        finder.insert(pos);
+        if (pendingLength >= kMinMatch && length == 0) {
+            match(pendingLength, pendingDistance);
+            const size_t matchEnd = pos - 1 + pendingLength;
+            for (size_t p = pos + 1; p < matchEnd; ++p) {
+                finder.insert(p);
+            }
+            pos = matchEnd;
+            pending = false;
+            pendingLength = 0;
+        } else {
+            if (pending) {
+                literal(buffer[pos - 1]);
+            }
+            pending = true;
+            pendingLength = length;
+            pendingDistance = distance;
+            ++pos;
+        }
+    }
+    if (pending) {
+        if (pendingLength >= kMinMatch) {
+            match(pendingLength, pendingDistance);
+        } else {
+            literal(buffer[pos - 1]);
+        }
+    }
+    bits.put(t.literalCode[256], t.literalBits[256]);  // end of block
+
+    if (!final) {
+        // Sync flush: an empty stored block brings the stream to a byte boundary.
+        bits.put(0, 3);
+        bits.alignToByte();
+        const uint8_t storedHeader[4] = {0x00, 0x00, 0xFF, 0xFF};
+        out.insert(out.end(), storedHeader, storedHeader + 4);
+    } else {
+        bits.alignToByte();
+    }
+}
+
+uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size)
+{
+    constexpr uint32_t kModulus = 65521;
+    constexpr size_t kMaxRun = 5552;  // longest run before the sums can overflow
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (size > 0) {
+        size_t run = std::min(size, kMaxRun);
+        size -= run;
+        for (size_t i = 0; i < run; ++i) {
+            a += data[i];
+            b += a;
+        }
+        data += run;
+        a %= kModulus;
+        b %= kModulus;
+    }
+    return (b << 16) | a;
+}
+
+uint32_t adler32Combine(uint32_t adlerA, uint32_t adlerB, size_t sizeB)
+{
+    // zlib's adler32_combine: shift A's sums by sizeB bytes, then add B's.
+    constexpr uint32_t kModulus = 65521;
+    const uint32_t remainder = static_cast<uint32_t>(sizeB % kModulus);
+    uint32_t sum1 = adlerA & 0xFFFF;
+    uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(remainder) * sum1) % kModulus);
+    sum1 += (adlerB & 0xFFFF) + kModulus - 1;
+    sum2 += (adlerA >> 16) + (adlerB >> 16) + kModulus - remainder;
+    if (sum1 >= kModulus) {
+        sum1 -= kModulus;
+    }
+    if (sum1 >= kModulus) {
+        sum1 -= kModulus;
+    }
+    if (sum2 >= kModulus * 2) {
+        sum2 -= kModulus * 2;
+    }
+    if (sum2 >= kModulus) {
+        sum2 -= kModulus;
+    }
+    return sum1 | (sum2 << 16);
+}
+
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+    const uint32_t* table = tables().crc;
+    uint32_t c = crc ^ 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
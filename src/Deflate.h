@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Minimal deflate (RFC 1951) encoder for the streaming image writers: LZ77
+// over a 32 KiB window with hash chains, coded with the fixed Huffman tables.
+// Levels follow zlib: 0 stores, 1-3 match greedily, 4-9 match lazily and
+// search ever longer hash chains.
+//
+// Input is compressed one chunk at a time. buffer holds dictionarySize bytes
+// of earlier input (at most kDeflateWindow are used) directly followed by the
+// size bytes to compress; matches may reach back into the dictionary, so
+// consecutive chunks compress as well as one long stream. The encoding of a
+// chunk always ends on a byte boundary: a non-final chunk ends with a sync
+// flush (an empty stored block), so chunk outputs can simply be concatenated
+// and chunks can be compressed independently, on different threads.
+
+constexpr size_t kDeflateWindow = 32768;
+constexpr int kDeflateMinLevel = 0;
+constexpr int kDeflateMaxLevel = 9;
+constexpr int kDeflateDefaultLevel = 6;
+
+void deflateChunk(const uint8_t* buffer, size_t dictionarySize, size_t size, bool final, int level,
+                  std::vector<uint8_t>& out);
+
+// Second byte of the zlib stream header (RFC 1950) after 0x78 for level.
+uint8_t zlibHeaderFlags(int level);
+
+// Running checksums; start from adler32 = 1 and crc32 = 0.
+uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size);
+// Adler-32 of A followed by B, from adler32 of each and the length of B.
+uint32_t adler32Combine(uint32_t adlerA, uint32_t adlerB, size_t sizeB);
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size);
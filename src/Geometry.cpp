@@ -0,0 +1,175 @@
+#include <Geometry.h>
+
+void SceneGeometry::addSphere(const glm::vec3& center, float radius, const Material& mat, uint32_t order)
+{
+    materials.push_back(mat);
+    spheres.centerX.push_back(center.x);
+    spheres.centerY.push_back(center.y);
+    spheres.centerZ.push_back(center.z);
+    spheres.radiusSq.push_back(radius * radius);
+    spheres.material.push_back(static_cast<uint32_t>(materials.size() - 1));
+    spheres.order.push_back(order);
+}
+
+void SceneGeometry::addPlane(const glm::vec3& normal, float d, const Material& mat, uint32_t order)
+{
+    materials.push_back(mat);
+    planes.normalX.push_back(normal.x);
+    planes.normalY.push_back(normal.y);
+    planes.normalZ.push_back(normal.z);
+    planes.d.push_back(d);
+    planes.material.push_back(static_cast<uint32_t>(materials.size() - 1));
+    planes.order.push_back(order);
+}
+
+void SceneGeometry::addLight(const glm::vec3& direction, const glm::vec3& position, const glm::vec3& intensity,
+                             bool isSpot, float cutoff)
+{
+    lights.dirX.push_back(direction.x);
+    lights.dirY.push_back(direction.y);
+    lights.dirZ.push_back(direction.z);
+    lights.posX.push_back(position.x);
+    lights.posY.push_back(position.y);
+    lights.posZ.push_back(position.z);
+    lights.intensityR.push_back(intensity.r);
+    lights.intensityG.push_back(intensity.g);
+    lights.intensityB.push_back(intensity.b);
+    lights.cutoff.push_back(cutoff);
+    lights.isSpot.push_back(isSpot ? 1 : 0);
+}
+
+void SceneGeometry::buildBvh()
+{
+    buildSphereBvh(makeGeometryView(*this), bvh);
+}
+
+void SceneGeometry::clear()
+{
+    *this = SceneGeometry{};
+}
+
+GeometryView makeGeometryView(const SceneGeometry& geometry)
+{
+    GeometryView view;
+    view.sphereX = geometry.spheres.centerX.data();
+    view.sphereY = geometry.spheres.centerY.data();
+    view.sphereZ = geometry.spheres.centerZ.data();
+    view.sphereRadiusSq = geometry.spheres.radiusSq.data();
+    view.sphereMaterial = geometry.spheres.material.data();
+    view.sphereOrder = geometry.spheres.order.data();
+    view.sphereCount = static_cast<uint32_t>(geometry.spheres.size());
+
+    view.planeX = geometry.planes.normalX.data();
+    view.planeY = geometry.planes.normalY.data();
+    view.planeZ = geometry.planes.normalZ.data();
+    view.planeD = geometry.planes.d.data();
+    view.planeMaterial = geometry.planes.material.data();
+    view.planeOrder = geometry.planes.order.data();
+    view.planeCount = static_cast<uint32_t>(geometry.planes.size());
+
+    view.materials = geometry.materials.data();
+    view.materialCount = static_cast<uint32_t>(geometry.materials.size());
+
+    view.nodes = geometry.bvh.nodes().data();
+    view.primIndices = geometry.bvh.primIndices().data();
+    view.nodeCount = static_cast<uint32_t>(geometry.bvh.nodes().size());
+    view.primIndexCount = static_cast<uint32_t>(geometry.bvh.primIndices().size());
+    return view;
+}
+
+LightView makeLightView(const LightArrays& lights)
+{
+    LightView view;
+    view.dirX = lights.dirX.data();
+    view.dirY = lights.dirY.data();
+    view.dirZ = lights.dirZ.data();
+    view.posX = lights.posX.data();
+    view.posY = lights.posY.data();
+    view.posZ = lights.posZ.data();
+    view.intensityR = lights.intensityR.data();
+    view.intensityG = lights.intensityG.data();
+    view.intensityB = lights.intensityB.data();
+    view.cutoff = lights.cutoff.data();
+    view.isSpot = lights.isSpot.data();
+    view.count = static_cast<uint32_t>(lights.size());
+    return view;
+}
+
+void buildSphereBvh(const GeometryView& view, Bvh& bvh)
+{
+    std::vector<Aabb> bounds(view.sphereCount);
+    for (uint32_t i = 0; i < view.sphereCount; ++i) {
+        glm::vec3 extent(std::sqrt(view.sphereRadiusSq[i]));
+        bounds[i].min = view.sphereCenter(i) - extent;
+        bounds[i].max = view.sphereCenter(i) + extent;
+    }
+    bvh.build(bounds);
+}
+
+glm::vec3 checkerboardColor(const glm::vec3& diffuse, const glm::vec3& point)
+{
+    // Checkerboard pattern projected on the XY plane
+    glm::vec3 rgbColor = diffuse;
+    float scaleParameter = 0.5f;
+    float checkerboard = 0.0f;
+    if (point.x < 0.0f) {
+        checkerboard += std::floor((0.5f - point.x) / scaleParameter);
+    } else {
+        checkerboard += std::floor(point.x / scaleParameter);
+    }
+
+    if (point.y < 0.0f) {
+        checkerboard += std::floor((0.5f - point.y) / scaleParameter);
+    } else {
+        checkerboard += std::floor(point.y / scaleParameter);
+    }
+
+    checkerboard = (checkerboard * 0.5f) - int(checkerboard * 0.5f);
+    checkerboard *= 2.0f;
+    if (checkerboard > 0.5f) {
+        return 0.5f * rgbColor;
+    }
+    return rgbColor;
+}
+
+Ray reflectedRay(const Ray& ray, const glm::vec3& point, const glm::vec3& normal, float epsilon)
+{
+    glm::vec3 n = glm::dot(ray.direction, normal) > 0.0f ? -normal : normal;
+    glm::vec3 reflectDir = glm::reflect(ray.direction, n);
+    return {point + reflectDir * epsilon, glm::normalize(reflectDir)};
+}
+
+Ray refractedRay(const GeometryView& geometry, PrimitiveRef prim, const Ray& ray, const glm::vec3& point,
+                 const glm::vec3& normal, float epsilon)
+{
+    bool outside = glm::dot(ray.direction, normal) < 0.0f;
+    glm::vec3 n = outside ? normal : -normal;
+    float eta = outside ? (kAirRefractiveIndex / kGlassRefractiveIndex) : (kGlassRefractiveIndex / kAirRefractiveIndex);
+
+    glm::vec3 refractDir = glm::refract(glm::normalize(ray.direction), n, eta);
+    if (glm::dot(refractDir, refractDir) < 1e-6f) {
+        // Total internal reflection
+        glm::vec3 reflectDir = glm::reflect(ray.direction, n);
+        return {point + reflectDir * epsilon, glm::normalize(reflectDir)};
+    }
+
+    Ray insideRay{point + refractDir * epsilon, glm::normalize(refractDir)};
+
+    // Advance until exiting the sphere
+    float exitT = 0.0f;
+    if (prim.kind == PrimitiveKind::Sphere &&
+        intersectSphere(geometry, prim.index, insideRay, epsilon, kMaxDistance, exitT)) {
+        glm::vec3 exitPoint = insideRay.origin + exitT * insideRay.direction;
+        glm::vec3 exitNormal = glm::normalize(exitPoint - geometry.sphereCenter(prim.index));
+        if (glm::dot(insideRay.direction, exitNormal) > 0.0f) {
+            exitNormal = -exitNormal;
+        }
+        glm::vec3 refractOutDir = glm::refract(insideRay.direction, exitNormal, kGlassRefractiveIndex / kAirRefractiveIndex);
+        if (glm::dot(refractOutDir, refractOutDir) < 1e-6f) {
+            refractOutDir = glm::reflect(insideRay.direction, exitNormal);
+        }
+        return {exitPoint + refractOutDir * epsilon, glm::normalize(refractOutDir)};
+    }
+
+    return insideRay;
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <Bvh.h>
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+enum class ObjectType {
+    Opaque,
+    Reflective,
+    Transparent
+};
+
+struct Material {
+    glm::vec3 ambient{0.0f};
+    glm::vec3 diffuse{0.0f};
+    glm::vec3 specular{0.7f, 0.7f, 0.7f};
+    float shininess{1.0f};
+    ObjectType type{ObjectType::Opaque};
+};
+
+struct CameraParams {
+    glm::vec3 eye{0.0f};
+    glm::vec3 up{0.0f, 1.0f, 0.0f};
+    glm::vec3 forward{0.0f, 0.0f, -1.0f};
+    float screenDistance{1.0f};
+    float screenWidth{2.0f};
+    float screenHeight{2.0f};
+};
+
+constexpr float kAirRefractiveIndex = 1.0f;
+constexpr float kGlassRefractiveIndex = 1.5f;
+constexpr float kMaxDistance = std::numeric_limits<float>::infinity();
+
+enum class PrimitiveKind : uint8_t {
+    None,
+    Sphere,
+    Plane
+};
+
+// Names one primitive in SceneGeometry: which array, and the slot in it.
+struct PrimitiveRef {
+    PrimitiveKind kind{PrimitiveKind::None};
+    uint32_t index{0};
+
+    bool operator==(const PrimitiveRef& o) const { return kind == o.kind && index == o.index; }
+    bool operator!=(const PrimitiveRef& o) const { return !(*this == o); }
+};
+
+// Structure-of-arrays sphere storage: the intersection loops only touch the
+// center and radius² streams, materials are looked up once per final hit.
+struct SphereArrays {
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radiusSq;
+    std::vector<uint32_t> material;
+    std::vector<uint32_t> order;  // position in the scene file, breaks exact ties in t
+
+    size_t size() const { return centerX.size(); }
+    glm::vec3 center(uint32_t i) const { return {centerX[i], centerY[i], centerZ[i]}; }
+};
+
+struct PlaneArrays {
+    std::vector<float> normalX;
+    std::vector<float> normalY;
+    std::vector<float> normalZ;
+    std::vector<float> d;
+    std::vector<uint32_t> material;
+    std::vector<uint32_t> order;
+
+    size_t size() const { return normalX.size(); }
+    glm::vec3 normal(uint32_t i) const { return {normalX[i], normalY[i], normalZ[i]}; }
+};
+
+struct LightArrays {
+    std::vector<float> dirX;  // unit; spot: cone axis, directional: toward the light
+    std::vector<float> dirY;
+    std::vector<float> dirZ;
+    std::vector<float> posX;  // spotlights only
+    std::vector<float> posY;
+    std::vector<float> posZ;
+    std::vector<float> intensityR;
+    std::vector<float> intensityG;
+    std::vector<float> intensityB;
+    std::vector<float> cutoff;  // cosine of the spot cone half-angle
+    std::vector<uint8_t> isSpot;
+
+    size_t size() const { return dirX.size(); }
+};
+
+// Render-time copy of the scene, built by CompiledScene::compile. Spheres are bounded and live in the BVH;
+// planes are unbounded and are always tested linearly.
+struct SceneGeometry {
+    SphereArrays spheres;
+    PlaneArrays planes;
+    std::vector<Material> materials;
+    LightArrays lights;
+    Bvh bvh;
+
+    void addSphere(const glm::vec3& center, float radius, const Material& mat, uint32_t order);
+    void addPlane(const glm::vec3& normal, float d, const Material& mat, uint32_t order);
+    void addLight(const glm::vec3& direction, const glm::vec3& position, const glm::vec3& intensity,
+                  bool isSpot, float cutoff);
+    void buildBvh();
+    void clear();
+};
+
+// Read-only view of flattened geometry, whatever owns the arrays: a
+// SceneGeometry, or a mapped binary scene file. The per-ISA kernels see
+// nothing but these views (and never call the inline helpers below, which
+// would otherwise be compiled with their instruction set).
+struct GeometryView {
+    const float* sphereX{nullptr};
+    const float* sphereY{nullptr};
+    const float* sphereZ{nullptr};
+    const float* sphereRadiusSq{nullptr};
+    const uint32_t* sphereMaterial{nullptr};
+    const uint32_t* sphereOrder{nullptr};
+    uint32_t sphereCount{0};
+
+    const float* planeX{nullptr};
+    const float* planeY{nullptr};
+    const float* planeZ{nullptr};
+    const float* planeD{nullptr};
+    const uint32_t* planeMaterial{nullptr};
+    const uint32_t* planeOrder{nullptr};
+    uint32_t planeCount{0};
+
+    const Material* materials{nullptr};
+    uint32_t materialCount{0};
+
+    const BvhNode* nodes{nullptr};
+    const uint32_t* primIndices{nullptr};
+    uint32_t nodeCount{0};
+    uint32_t primIndexCount{0};
+
+    glm::vec3 sphereCenter(uint32_t i) const { return {sphereX[i], sphereY[i], sphereZ[i]}; }
+    glm::vec3 planeNormal(uint32_t i) const { return {planeX[i], planeY[i], planeZ[i]}; }
+    uint32_t materialIndex(PrimitiveRef prim) const
+    {
+        return prim.kind == PrimitiveKind::Sphere ? sphereMaterial[prim.index] : planeMaterial[prim.index];
+    }
+};
+
+struct LightView {
+    const float* dirX{nullptr};
+    const float* dirY{nullptr};
+    const float* dirZ{nullptr};
+    const float* posX{nullptr};
+    const float* posY{nullptr};
+    const float* posZ{nullptr};
+    const float* intensityR{nullptr};
+    const float* intensityG{nullptr};
+    const float* intensityB{nullptr};
+    const float* cutoff{nullptr};
+    const uint8_t* isSpot{nullptr};
+    uint32_t count{0};
+};
+
+GeometryView makeGeometryView(const SceneGeometry& geometry);
+LightView makeLightView(const LightArrays& lights);
+
+// Builds bvh over the spheres of view (planes are unbounded and stay out).
+void buildSphereBvh(const GeometryView& view, Bvh& bvh);
+
+// Scalar kernels. The SIMD kernels reproduce them operation for operation so
+// every ISA rounds identically.
+inline bool intersectSphere(const GeometryView& g, uint32_t i, const Ray& ray, float tMin, float tMax, float& tHit)
+{
+    float ocx = ray.origin.x - g.sphereX[i];
+    float ocy = ray.origin.y - g.sphereY[i];
+    float ocz = ray.origin.z - g.sphereZ[i];
+    const glm::vec3& d = ray.direction;
+
+    float a = d.x * d.x + d.y * d.y + d.z * d.z;
+    float b = 2.0f * (ocx * d.x + ocy * d.y + ocz * d.z);
+    float c = (ocx * ocx + ocy * ocy + ocz * ocz) - g.sphereRadiusSq[i];
+    float discriminant = b * b - 4.0f * a * c;
+    if (discriminant < 0.0f) {
+        return false;
+    }
+
+    float sqrtD = std::sqrt(discriminant);
+    float t = (-b - sqrtD) / (2.0f * a);
+    if (t < tMin || t > tMax) {
+        t = (-b + sqrtD) / (2.0f * a);
+        if (t < tMin || t > tMax) {
+            return false;
+        }
+    }
+    tHit = t;
+    return true;
+}
+
+// Checkerboard pattern that planes apply on top of their diffuse color.
+glm::vec3 checkerboardColor(const glm::vec3& diffuse, const glm::vec3& point);
+
+// Continuation of a path that hit a mirror or glass at point; normal is the
+// unflipped surface normal there. Refraction steps through a sphere in one go.
+Ray reflectedRay(const Ray& ray, const glm::vec3& point, const glm::vec3& normal, float epsilon);
+Ray refractedRay(const GeometryView& geometry, PrimitiveRef prim, const Ray& ray, const glm::vec3& point,
+                 const glm::vec3& normal, float epsilon);
@@ -0,0 +1,36 @@
+#include <Hash.h>
+
+#include <cstring>
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+{
+    constexpr uint64_t kMul = 0xC6A4A7935BD1E995ULL;
+    constexpr int kShift = 47;
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t h = seed ^ (size * kMul);
+    const size_t blocks = size / 8;
+    for (size_t i = 0; i < blocks; ++i) {
+        uint64_t k = 0;
+        std::memcpy(&k, bytes + i * 8, 8);
+        k *= kMul;
+        k ^= k >> kShift;
+        k *= kMul;
+        h ^= k;
+        h *= kMul;
+    }
+
+    const unsigned char* tail = bytes + blocks * 8;
+    const size_t rest = size & 7;
+    if (rest > 0) {
+        for (size_t i = rest; i-- > 0;) {
+            h ^= static_cast<uint64_t>(tail[i]) << (8 * i);
+        }
+        h *= kMul;
+    }
+
+    h ^= h >> kShift;
+    h *= kMul;
+    h ^= h >> kShift;
+    return h;
+}
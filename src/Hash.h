@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit MurmurHash2 (MurmurHash64A): a fast, non-cryptographic content hash
+// for fingerprints and cache keys. Hash several pieces in a row by passing
+// the previous result as the seed.
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
@@ -0,0 +1,185 @@
+#include <HdrWriter.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+    bool hostIsLittleEndian()
+    {
+        const uint16_t probe = 1;
+        uint8_t first = 0;
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+
+    // IEEE binary32 to binary16, rounding to nearest even; overflow gives
+    // infinity and tiny values become half subnormals.
+    uint16_t floatToHalf(float value)
+    {
+        uint32_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+        const uint32_t magnitude = bits & 0x7FFFFFFF;
+
+        if (magnitude >= 0x7F800000) {
+            return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x0200 : 0);  // infinity or quiet NaN
+        }
+        if (magnitude >= 0x477FF000) {
+            return sign | 0x7C00;  // rounds past 65504
+        }
+        if (magnitude < 0x38800000) {
+            // Below the smallest normal half (2^-14).
+            if (magnitude < 0x33000000) {
+                return sign;  // at most 2^-25: rounds to zero
+            }
+            const uint32_t exponent = magnitude >> 23;
+            const uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+            const uint32_t shift = 126 - exponent;
+            uint32_t half = mantissa >> shift;
+            const uint32_t rest = mantissa & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+            if (rest > halfway || (rest == halfway && (half & 1))) {
+                ++half;
+            }
+            return sign | static_cast<uint16_t>(half);
+        }
+        uint32_t half = (magnitude - 0x38000000) >> 13;  // rebias the exponent from 127 to 15
+        const uint32_t rest = magnitude & 0x1FFF;
+        if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+            ++half;  // a carry into the exponent is still the right result
+        }
+        return sign | static_cast<uint16_t>(half);
+    }
+
+    // Little-endian output buffer for the EXR header and scanlines.
+    struct ByteWriter {
+        std::vector<uint8_t> bytes;
+
+        void u8(uint8_t v) { bytes.push_back(v); }
+        void u16(uint16_t v)
+        {
+            u8(static_cast<uint8_t>(v));
+            u8(static_cast<uint8_t>(v >> 8));
+        }
+        void u32(uint32_t v)
+        {
+            u16(static_cast<uint16_t>(v));
+            u16(static_cast<uint16_t>(v >> 16));
+        }
+        void u64(uint64_t v)
+        {
+            u32(static_cast<uint32_t>(v));
+            u32(static_cast<uint32_t>(v >> 32));
+        }
+        void f32(float v)
+        {
+            uint32_t bits = 0;
+            std::memcpy(&bits, &v, sizeof(bits));
+            u32(bits);
+        }
+        void str(const char* s) { bytes.insert(bytes.end(), s, s + std::strlen(s) + 1); }
+        void attribute(const char* name, const char* type, uint32_t size)
+        {
+            str(name);
+            str(type);
+            u32(size);
+        }
+    };
+
+    bool finish(std::ofstream& out, const std::string& path)
+    {
+        if (!out.good()) {
+            std::cerr << "Failed to write image: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+bool writePFM(const std::string& path, const float* rgb, int width, int height)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to write image: " << path << std::endl;
+        return false;
+    }
+    // A negative scale marks little-endian data. Rows run bottom to top.
+    out << "PF\n" << width << " " << height << "\n" << (hostIsLittleEndian() ? "-1.0" : "1.0") << "\n";
+    const size_t rowFloats = static_cast<size_t>(width) * 3;
+    for (int y = height - 1; y >= 0; --y) {
+        out.write(reinterpret_cast<const char*>(rgb + rowFloats * y),
+                  static_cast<std::streamsize>(rowFloats * sizeof(float)));
+    }
+    return finish(out, path);
+}
+
+bool writeEXR(const std::string& path, const float* rgb, int width, int height)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to write image: " << path << std::endl;
+        return false;
+    }
+
+    ByteWriter header;
+    header.u32(20000630);  // magic
+    header.u32(2);         // version 2, single-part scanline file
+
+    // Channels are listed, and stored, in alphabetical order.
+    const char* channels[3] = {"B", "G", "R"};
+    header.attribute("channels", "chlist", 3 * (2 + 16) + 1);
+    for (const char* name : channels) {
+        header.str(name);
+        header.u32(1);  // HALF
+        header.u32(0);  // pLinear + reserved
+        header.u32(1);  // x sampling
+        header.u32(1);  // y sampling
+    }
+    header.u8(0);
+    header.attribute("compression", "compression", 1);
+    header.u8(0);  // NO_COMPRESSION
+    for (const char* window : {"dataWindow", "displayWindow"}) {
+        header.attribute(window, "box2i", 16);
+        header.u32(0);
+        header.u32(0);
+        header.u32(static_cast<uint32_t>(width - 1));
+        header.u32(static_cast<uint32_t>(height - 1));
+    }
+    header.attribute("lineOrder", "lineOrder", 1);
+    header.u8(0);  // INCREASING_Y
+    header.attribute("pixelAspectRatio", "float", 4);
+    header.f32(1.0f);
+    header.attribute("screenWindowCenter", "v2f", 8);
+    header.f32(0.0f);
+    header.f32(0.0f);
+    header.attribute("screenWindowWidth", "float", 4);
+    header.f32(1.0f);
+    header.u8(0);  // end of header
+
+    // Uncompressed files hold one scanline per block, so every block has the same size.
+    const uint32_t lineBytes = static_cast<uint32_t>(width) * 3 * 2;
+    const uint64_t blockBytes = 8 + static_cast<uint64_t>(lineBytes);
+    const uint64_t firstBlock = header.bytes.size() + 8 * static_cast<uint64_t>(height);
+    for (int y = 0; y < height; ++y) {
+        header.u64(firstBlock + blockBytes * y);
+    }
+    out.write(reinterpret_cast<const char*>(header.bytes.data()), static_cast<std::streamsize>(header.bytes.size()));
+
+    ByteWriter line;
+    for (int y = 0; y < height; ++y) {
+        line.bytes.clear();
+        line.u32(static_cast<uint32_t>(y));
+        line.u32(lineBytes);
+        const float* row = rgb + static_cast<size_t>(width) * 3 * y;
+        for (int channel = 2; channel >= 0; --channel) {  // B, G, R
+            for (int x = 0; x < width; ++x) {
+                line.u16(floatToHalf(row[x * 3 + channel]));
+            }
+        }
+        out.write(reinterpret_cast<const char*>(line.bytes.data()), static_cast<std::streamsize>(line.bytes.size()));
+    }
+    return finish(out, path);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+// Uncompressed writers for the float framebuffer (tightly packed linear RGB,
+// top row first), for pipelines that composite in HDR.
+
+// Portable float map: 32-bit floats, exactly what the renderer produced.
+bool writePFM(const std::string& path, const float* rgb, int width, int height);
+// Scanline OpenEXR with half-float R, G, B channels and no compression.
+bool writeEXR(const std::string& path, const float* rgb, int width, int height);
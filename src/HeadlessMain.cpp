@@ -0,0 +1,10 @@
+// The render command line without the OpenGL front end: links only the
+// static renderer library (bin/libraytracer.a), for machines with no
+// display libraries.
+
+#include <RenderCli.h>
+
+int main(int argc, char* argv[])
+{
+    return runRenderCli(argc, argv);
+}
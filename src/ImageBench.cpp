@@ -0,0 +1,123 @@
+// Encode time and output size of every 8-bit output writer, measured on
+// frames rendered from the given scenes. Each scene is rendered once; every
+// writer then encodes the same pixels --repeat times and the fastest run is
+// reported (open to close, without an fsync: time until the bytes are in the
+// page cache). Each file is written as <out-dir>/<scene>.bench.<ext>.
+//
+//   image_bench [--size N] [--repeat N] [--threads N] [--out-dir DIR] <scene>...
+
+#include <RayTracer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+namespace {
+    struct BenchWriter {
+        const char* label;
+        ImageFormat format;
+        int pngLevel;
+        const char* extension;
+    };
+
+    const BenchWriter kWriters[] = {
+        {"png (level 6)", ImageFormat::Png, kDeflateDefaultLevel, ".png"},
+        {"png (level 1)", ImageFormat::Png, 1, ".png"},
+        {"ppm", ImageFormat::Ppm, 0, ".ppm"},
+        {"qoi", ImageFormat::Qoi, 0, ".qoi"},
+        {"raw rgb (mmap)", ImageFormat::RawRgb, 0, ".rgb"},
+    };
+
+    long long fileSize(const std::string& path)
+    {
+        struct stat st{};
+        return stat(path.c_str(), &st) == 0 ? static_cast<long long>(st.st_size) : -1;
+    }
+
+    std::string baseName(const std::string& path)
+    {
+        size_t slash = path.find_last_of("/\\");
+        std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+        size_t dot = name.find_last_of('.');
+        return dot == std::string::npos ? name : name.substr(0, dot);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int size = 1000;
+    int repeat = 5;
+    int threadCount = 0;
+    std::string outDir = ".";
+    std::vector<std::string> scenes;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--size" || arg == "--repeat" || arg == "--threads") && i + 1 < argc) {
+            int value = 0;
+            try {
+                value = std::stoi(argv[++i]);
+            } catch (const std::exception&) {
+                value = -1;
+            }
+            if (value < (arg == "--threads" ? 0 : 1)) {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+                return 1;
+            }
+            (arg == "--size" ? size : arg == "--repeat" ? repeat : threadCount) = value;
+        } else if (arg == "--out-dir" && i + 1 < argc) {
+            outDir = argv[++i];
+        } else if (arg.rfind("--", 0) == 0) {
+            scenes.clear();
+            break;
+        } else {
+            scenes.push_back(arg);
+        }
+    }
+    if (scenes.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--size N] [--repeat N] [--threads N] [--out-dir DIR] <scene>..."
+                  << std::endl;
+        return 1;
+    }
+
+    const double rawBytes = static_cast<double>(size) * size * 3;
+    std::cout << size << "x" << size << " frames, best of " << repeat << " encodes\n"
+              << std::left << std::setw(14) << "scene" << std::setw(16) << "writer" << std::right << std::setw(10)
+              << "ms" << std::setw(10) << "MB/s" << std::setw(12) << "bytes" << std::setw(8) << "ratio" << "\n";
+    std::cout << std::fixed;
+
+    for (const std::string& scene : scenes) {
+        RayTracer tracer(size, size);
+        tracer.setThreadCount(threadCount);
+        if (!tracer.loadScene(scene)) {
+            std::cerr << "Failed to load scene: " << scene << std::endl;
+            return 1;
+        }
+        const std::vector<unsigned char> pixels = tracer.render();
+
+        for (const BenchWriter& writer : kWriters) {
+            // The ".bench" suffix keeps the default --out-dir from overwriting renders kept next to the scenes.
+            const std::string path = outDir + "/" + baseName(scene) + ".bench" + writer.extension;
+            tracer.setPngLevel(writer.pngLevel);
+            double best = 0.0;
+            for (int run = 0; run < repeat; ++run) {
+                auto start = std::chrono::steady_clock::now();
+                if (!tracer.writeImage(path, writer.format, pixels)) {
+                    return 1;
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                best = run == 0 ? seconds : std::min(best, seconds);
+            }
+            const long long bytes = fileSize(path);
+            std::cout << std::left << std::setw(14) << baseName(scene) << std::setw(16) << writer.label << std::right
+                      << std::setprecision(2) << std::setw(10) << best * 1000.0 << std::setprecision(0)
+                      << std::setw(10) << rawBytes / 1e6 / best << std::setw(12) << bytes << std::setprecision(3)
+                      << std::setw(8) << static_cast<double>(bytes) / rawBytes << "\n";
+        }
+    }
+    return 0;
+}
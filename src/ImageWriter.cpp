@@ -0,0 +1,344 @@
+#include <ImageWriter.h>
+#include <PngWriter.h>
+
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr int kChannels = 3;
+    constexpr int kQoiMaxRun = 62;
+    constexpr unsigned char kQoiOpIndex = 0x00;
+    constexpr unsigned char kQoiOpDiff = 0x40;
+    constexpr unsigned char kQoiOpLuma = 0x80;
+    constexpr unsigned char kQoiOpRun = 0xC0;
+    constexpr unsigned char kQoiOpRgb = 0xFE;
+    constexpr unsigned char kQoiEnd[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+    bool fail(const std::string& path, const std::string& message)
+    {
+        std::cerr << "Failed to write image: " << path << " (" << message << ")" << std::endl;
+        return false;
+    }
+
+    bool checkRows(const std::string& path, int rowCount, int rowsWritten, int height)
+    {
+        if (rowCount <= 0 || rowCount > height - rowsWritten) {
+            return fail(path, "more rows than the image height");
+        }
+        return true;
+    }
+
+    bool checkComplete(const std::string& path, int rowsWritten, int height)
+    {
+        if (rowsWritten != height) {
+            return fail(path, "only " + std::to_string(rowsWritten) + " of " + std::to_string(height) +
+                                  " rows written");
+        }
+        return true;
+    }
+
+    bool hasExtension(const std::string& path, const char* ext)
+    {
+        const size_t length = std::strlen(ext);
+        if (path.size() < length) {
+            return false;
+        }
+        for (size_t i = 0; i < length; ++i) {
+            if (std::tolower(static_cast<unsigned char>(path[path.size() - length + i])) != ext[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void putBigEndian(unsigned char* out, uint32_t value)
+    {
+        out[0] = static_cast<unsigned char>(value >> 24);
+        out[1] = static_cast<unsigned char>(value >> 16);
+        out[2] = static_cast<unsigned char>(value >> 8);
+        out[3] = static_cast<unsigned char>(value);
+    }
+}
+
+const char* imageFormatName(ImageFormat format)
+{
+    switch (format) {
+        case ImageFormat::Ppm:
+            return "ppm";
+        case ImageFormat::Qoi:
+            return "qoi";
+        case ImageFormat::RawRgb:
+            return "raw rgb";
+        default:
+            return "png";
+    }
+}
+
+ImageFormat imageFormatForPath(const std::string& path)
+{
+    if (hasExtension(path, ".ppm")) {
+        return ImageFormat::Ppm;
+    }
+    if (hasExtension(path, ".qoi")) {
+        return ImageFormat::Qoi;
+    }
+    if (hasExtension(path, ".rgb") || hasExtension(path, ".raw")) {
+        return ImageFormat::RawRgb;
+    }
+    return ImageFormat::Png;
+}
+
+std::unique_ptr<ImageStreamWriter> makeImageWriter(ImageFormat format)
+{
+    switch (format) {
+        case ImageFormat::Ppm:
+            return std::make_unique<PpmStreamWriter>();
+        case ImageFormat::Qoi:
+            return std::make_unique<QoiStreamWriter>();
+        case ImageFormat::RawRgb:
+            return std::make_unique<RawRgbWriter>();
+        default:
+            return std::make_unique<PngStreamWriter>();
+    }
+}
+
+bool PpmStreamWriter::open(const std::string& path, int width, int height)
+{
+    m_Path = path;
+    if (width <= 0 || height <= 0) {
+        return fail(path, "invalid image size");
+    }
+    m_Out.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_Out.is_open()) {
+        return fail(path, "cannot open file for writing");
+    }
+    m_Width = width;
+    m_Height = height;
+    m_RowsWritten = 0;
+    m_Out << "P6\n" << width << " " << height << "\n255\n";
+    return m_Out.good() || fail(path, "write failed");
+}
+
+bool PpmStreamWriter::writeRows(const unsigned char* rows, int rowCount)
+{
+    if (!m_Out.is_open()) {
+        return fail(m_Path, "not open");
+    }
+    if (!checkRows(m_Path, rowCount, m_RowsWritten, m_Height)) {
+        return false;
+    }
+    m_Out.write(reinterpret_cast<const char*>(rows),
+                static_cast<std::streamsize>(static_cast<size_t>(m_Width) * kChannels * rowCount));
+    m_RowsWritten += rowCount;
+    return m_Out.good() || fail(m_Path, "write failed");
+}
+
+bool PpmStreamWriter::close()
+{
+    if (!m_Out.is_open()) {
+        return fail(m_Path, "not open");
+    }
+    bool complete = checkComplete(m_Path, m_RowsWritten, m_Height);
+    m_Out.close();
+    return complete && !m_Out.fail();
+}
+
+bool QoiStreamWriter::open(const std::string& path, int width, int height)
+{
+    m_Path = path;
+    if (width <= 0 || height <= 0) {
+        return fail(path, "invalid image size");
+    }
+    m_Out.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_Out.is_open()) {
+        return fail(path, "cannot open file for writing");
+    }
+    m_Width = width;
+    m_Height = height;
+    m_RowsWritten = 0;
+    std::memset(m_Prev, 0, sizeof(m_Prev));
+    std::memset(m_IndexUsed, 0, sizeof(m_IndexUsed));
+    m_Run = 0;
+
+    unsigned char header[14] = {'q', 'o', 'i', 'f'};
+    putBigEndian(header + 4, static_cast<uint32_t>(width));
+    putBigEndian(header + 8, static_cast<uint32_t>(height));
+    header[12] = kChannels;
+    header[13] = 0;  // sRGB with linear alpha: the only choice that says nothing extra
+    m_Out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    return m_Out.good() || fail(path, "write failed");
+}
+
+void QoiStreamWriter::flushRun()
+{
+    if (m_Run > 0) {
+        m_Buffer.push_back(static_cast<unsigned char>(kQoiOpRun | (m_Run - 1)));
+        m_Run = 0;
+    }
+}
+
+bool QoiStreamWriter::writeRows(const unsigned char* rows, int rowCount)
+{
+    if (!m_Out.is_open()) {
+        return fail(m_Path, "not open");
+    }
+    if (!checkRows(m_Path, rowCount, m_RowsWritten, m_Height)) {
+        return false;
+    }
+
+    const size_t pixelCount = static_cast<size_t>(m_Width) * rowCount;
+    m_Buffer.clear();
+    m_Buffer.reserve(pixelCount * (kChannels + 1));  // worst case: every pixel a QOI_OP_RGB
+    for (size_t i = 0; i < pixelCount; ++i) {
+        const unsigned char* px = rows + i * kChannels;
+        if (px[0] == m_Prev[0] && px[1] == m_Prev[1] && px[2] == m_Prev[2]) {
+            if (++m_Run == kQoiMaxRun) {
+                flushRun();
+            }
+            continue;
+        }
+        flushRun();
+
+        // Alpha is always 255, which contributes 255 * 11 to the hash.
+        const int slot = (px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) % 64;
+        if (m_IndexUsed[slot] && std::memcmp(m_Index[slot], px, kChannels) == 0) {
+            m_Buffer.push_back(static_cast<unsigned char>(kQoiOpIndex | slot));
+        } else {
+            std::memcpy(m_Index[slot], px, kChannels);
+            m_IndexUsed[slot] = true;
+            // Differences wrap around like the decoder's byte arithmetic.
+            const int dr = static_cast<signed char>(px[0] - m_Prev[0]);
+            const int dg = static_cast<signed char>(px[1] - m_Prev[1]);
+            const int db = static_cast<signed char>(px[2] - m_Prev[2]);
+            const int drDg = dr - dg;
+            const int dbDg = db - dg;
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                m_Buffer.push_back(static_cast<unsigned char>(kQoiOpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+            } else if (dg >= -32 && dg <= 31 && drDg >= -8 && drDg <= 7 && dbDg >= -8 && dbDg <= 7) {
+                m_Buffer.push_back(static_cast<unsigned char>(kQoiOpLuma | (dg + 32)));
+                m_Buffer.push_back(static_cast<unsigned char>((drDg + 8) << 4 | (dbDg + 8)));
+            } else {
+                m_Buffer.insert(m_Buffer.end(), {kQoiOpRgb, px[0], px[1], px[2]});
+            }
+        }
+        std::memcpy(m_Prev, px, kChannels);
+    }
+    m_RowsWritten += rowCount;
+    if (m_RowsWritten == m_Height) {
+        flushRun();
+        m_Buffer.insert(m_Buffer.end(), kQoiEnd, kQoiEnd + sizeof(kQoiEnd));
+    }
+
+    m_Out.write(reinterpret_cast<const char*>(m_Buffer.data()), static_cast<std::streamsize>(m_Buffer.size()));
+    return m_Out.good() || fail(m_Path, "write failed");
+}
+
+bool QoiStreamWriter::close()
+{
+    if (!m_Out.is_open()) {
+        return fail(m_Path, "not open");
+    }
+    bool complete = checkComplete(m_Path, m_RowsWritten, m_Height);
+    m_Out.close();
+    m_Buffer = {};
+    return complete && !m_Out.fail();
+}
+
+RawRgbWriter::~RawRgbWriter()
+{
+    unmap();
+}
+
+bool RawRgbWriter::open(const std::string& path, int width, int height)
+{
+    unmap();
+    m_Path = path;
+    if (width <= 0 || height <= 0) {
+        return fail(path, "invalid image size");
+    }
+    m_Size = static_cast<size_t>(width) * height * kChannels;
+    m_Width = width;
+    m_Height = height;
+    m_RowsWritten = 0;
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return fail(path, "cannot open file for writing");
+    }
+    if (ftruncate(fd, static_cast<off_t>(m_Size)) != 0) {
+        ::close(fd);
+        return fail(path, "cannot size the file");
+    }
+    void* mapped = mmap(nullptr, m_Size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);  // the mapping stays valid
+    if (mapped == MAP_FAILED) {
+        return fail(path, "cannot map the file");
+    }
+    m_Data = static_cast<unsigned char*>(mapped);
+    return true;
+#else
+    m_Out.open(path, std::ios::binary | std::ios::trunc);
+    return m_Out.is_open() || fail(path, "cannot open file for writing");
+#endif
+}
+
+bool RawRgbWriter::isOpen() const
+{
+#ifndef _WIN32
+    return m_Data != nullptr;
+#else
+    return m_Out.is_open();
+#endif
+}
+
+bool RawRgbWriter::writeRows(const unsigned char* rows, int rowCount)
+{
+    if (!isOpen()) {
+        return fail(m_Path, "not open");
+    }
+    if (!checkRows(m_Path, rowCount, m_RowsWritten, m_Height)) {
+        return false;
+    }
+    const size_t rowBytes = static_cast<size_t>(m_Width) * kChannels;
+#ifndef _WIN32
+    std::memcpy(m_Data + rowBytes * m_RowsWritten, rows, rowBytes * rowCount);
+#else
+    m_Out.write(reinterpret_cast<const char*>(rows), static_cast<std::streamsize>(rowBytes * rowCount));
+    if (!m_Out.good()) {
+        return fail(m_Path, "write failed");
+    }
+#endif
+    m_RowsWritten += rowCount;
+    return true;
+}
+
+bool RawRgbWriter::close()
+{
+    if (!isOpen()) {
+        return fail(m_Path, "not open");
+    }
+    bool complete = checkComplete(m_Path, m_RowsWritten, m_Height);
+    unmap();
+    return complete;
+}
+
+void RawRgbWriter::unmap()
+{
+#ifndef _WIN32
+    if (m_Data) {
+        munmap(m_Data, m_Size);  // dirty pages are written back by the kernel
+        m_Data = nullptr;
+    }
+#else
+    if (m_Out.is_open()) {
+        m_Out.close();
+    }
+#endif
+}
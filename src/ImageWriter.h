@@ -0,0 +1,102 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 8-bit RGB encoders that take the image a band of rows at a time, so every
+// format can be fed straight from RayTracer::renderBands.
+class ImageStreamWriter {
+  public:
+    virtual ~ImageStreamWriter() = default;
+
+    virtual bool open(const std::string& path, int width, int height) = 0;
+    // rows holds rowCount tightly packed RGB rows, continuing where the last call stopped.
+    virtual bool writeRows(const unsigned char* rows, int rowCount) = 0;
+    // Fails unless exactly height rows were written.
+    virtual bool close() = 0;
+};
+
+enum class ImageFormat {
+    Png,     // deflated, smallest; see PngStreamWriter
+    Ppm,     // binary P6: a text header and the raw bytes
+    Qoi,     // "Quite OK Image" format: one fast pass, no entropy coder
+    RawRgb   // headerless RGB bytes, written through a shared file mapping
+};
+
+const char* imageFormatName(ImageFormat format);
+// The format path's extension names: .ppm, .qoi, .rgb or .raw; anything else is PNG.
+ImageFormat imageFormatForPath(const std::string& path);
+// A writer with default settings for format.
+std::unique_ptr<ImageStreamWriter> makeImageWriter(ImageFormat format);
+
+class PpmStreamWriter : public ImageStreamWriter {
+  public:
+    bool open(const std::string& path, int width, int height) override;
+    bool writeRows(const unsigned char* rows, int rowCount) override;
+    bool close() override;
+
+  private:
+    std::ofstream m_Out;
+    std::string m_Path;
+    int m_Width{0};
+    int m_Height{0};
+    int m_RowsWritten{0};
+};
+
+// Makes the same choice of op per pixel as the reference encoder (qoi.h).
+// The run and the 64-entry color index carry over from band to band; each
+// band is encoded into a buffer and written in one call.
+class QoiStreamWriter : public ImageStreamWriter {
+  public:
+    bool open(const std::string& path, int width, int height) override;
+    bool writeRows(const unsigned char* rows, int rowCount) override;
+    bool close() override;
+
+  private:
+    void flushRun();
+
+  private:
+    std::ofstream m_Out;
+    std::string m_Path;
+    int m_Width{0};
+    int m_Height{0};
+    int m_RowsWritten{0};
+    unsigned char m_Prev[3]{0, 0, 0};
+    unsigned char m_Index[64][3]{};
+    bool m_IndexUsed[64]{};
+    int m_Run{0};
+    std::vector<unsigned char> m_Buffer;
+};
+
+// Sizes the file up front and copies each band into a shared mapping of it,
+// leaving the write-back to the kernel: no encoding and no write calls.
+// The file has no header; the size is whatever the render used.
+class RawRgbWriter : public ImageStreamWriter {
+  public:
+    RawRgbWriter() = default;
+    ~RawRgbWriter() override;
+
+    RawRgbWriter(const RawRgbWriter&) = delete;
+    RawRgbWriter& operator=(const RawRgbWriter&) = delete;
+
+    bool open(const std::string& path, int width, int height) override;
+    bool writeRows(const unsigned char* rows, int rowCount) override;
+    bool close() override;
+
+  private:
+    bool isOpen() const;
+    void unmap();
+
+  private:
+    std::string m_Path;
+    unsigned char* m_Data{nullptr};
+    size_t m_Size{0};
+    int m_Width{0};
+    int m_Height{0};
+    int m_RowsWritten{0};
+#ifdef _WIN32
+    std::ofstream m_Out;  // no mapping here: written through a stream instead
+#endif
+};
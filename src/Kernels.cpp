@@ -0,0 +1,132 @@
+#include <Kernels.h>
+
+#include <atomic>
+
+// Defined by the per-ISA translation units.
+const KernelTable& kernelTableGeneric();
+#if defined(__x86_64__) || defined(_M_X64)
+const KernelTable& kernelTableSse42();
+const KernelTable& kernelTableAvx2();
+const KernelTable& kernelTableAvx512();
+#endif
+
+namespace {
+    const KernelTable& tableFor(Isa isa)
+    {
+        switch (isa) {
+#if defined(__x86_64__) || defined(_M_X64)
+            case Isa::Sse42:
+                return kernelTableSse42();
+            case Isa::Avx2:
+                return kernelTableAvx2();
+            case Isa::Avx512:
+                return kernelTableAvx512();
+#endif
+            case Isa::Generic:
+            default:
+                return kernelTableGeneric();
+        }
+    }
+
+    Isa bestIsa()
+    {
+        for (Isa isa : {Isa::Avx512, Isa::Avx2, Isa::Sse42}) {
+            if (isaSupported(isa)) {
+                return isa;
+            }
+        }
+        return Isa::Generic;
+    }
+
+    std::atomic<const KernelTable*>& activeTable()
+    {
+        static std::atomic<const KernelTable*> table{&tableFor(bestIsa())};
+        return table;
+    }
+}
+
+bool isaSupported(Isa isa)
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    // __builtin_cpu_supports reads cpuid once at startup and also checks that
+    // the OS saves the wider register state (xgetbv) for AVX and AVX-512.
+    switch (isa) {
+        case Isa::Generic:
+            return true;
+        case Isa::Sse42:
+            return __builtin_cpu_supports("sse4.2");
+        case Isa::Avx2:
+            return __builtin_cpu_supports("avx2");
+        case Isa::Avx512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl");
+    }
+    return false;
+#else
+    return isa == Isa::Generic;
+#endif
+}
+
+const char* isaName(Isa isa)
+{
+    switch (isa) {
+        case Isa::Sse42:
+            return "sse4.2";
+        case Isa::Avx2:
+            return "avx2";
+        case Isa::Avx512:
+            return "avx512";
+        case Isa::Generic:
+        default:
+            return "generic";
+    }
+}
+
+bool parseIsa(const std::string& name, Isa& outIsa)
+{
+    for (Isa isa : {Isa::Generic, Isa::Sse42, Isa::Avx2, Isa::Avx512}) {
+        if (name == isaName(isa)) {
+            outIsa = isa;
+            return true;
+        }
+    }
+    return false;
+}
+
+const KernelTable& activeKernels()
+{
+    return *activeTable().load(std::memory_order_acquire);
+}
+
+bool forceIsa(Isa isa)
+{
+    if (!isaSupported(isa)) {
+        return false;
+    }
+    activeTable().store(&tableFor(isa), std::memory_order_release);
+    return true;
+}
+
+bool packetWidthSupported(int width)
+{
+    const KernelTable& kernels = activeKernels();
+    switch (width) {
+        case 1:
+            return true;
+        case 4:
+            return kernels.closestHitPacket4 != nullptr;
+        case 8:
+            return kernels.closestHitPacket8 != nullptr;
+        default:
+            return false;
+    }
+}
+
+int widestPacketWidth()
+{
+    for (int width = kMaxPacketWidth; width > 1; width /= 2) {
+        if (packetWidthSupported(width)) {
+            return width;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <Bvh.h>
+#include <Geometry.h>
+
+#include <cstdint>
+#include <string>
+
+// The hot loops of the tracer (closest hit, occlusion, the Phong light loop
+// and the packet queries) are compiled once per instruction set in the
+// Kernels<Isa>.cpp files and picked at startup from what cpuid reports.
+//
+// The kernels only see the plain GeometryView / LightView from Geometry.h, so
+// the ISA-specific translation units never instantiate glm or std::vector code
+// of their own.
+
+// Closest hit of a single ray. order == -1 means no hit.
+struct ScalarHit {
+    float t{0.0f};
+    int32_t order{-1};
+    uint32_t index{0};
+    uint32_t kind{0};  // PrimitiveKind
+};
+
+// Everything the Phong light loop needs about one opaque hit.
+struct PhongInput {
+    float point[3];
+    float normal[3];     // already facing the incoming ray
+    float viewDir[3];
+    float baseColor[3];
+    float specular[3];
+    float shininess;
+    float epsilon;
+    uint32_t ignoreKind;   // the hit primitive never shadows itself
+    uint32_t ignoreIndex;
+};
+
+// Per-thread memory of the primitive that last blocked each light. Shadow rays
+// of neighbouring pixels are usually stopped by the same object, so the
+// occlusion query tries that one before traversing anything. Lights past
+// kOccluderCacheLights are simply not cached.
+constexpr uint32_t kOccluderCacheLights = 16;
+
+struct OccluderCache {
+    uint32_t kind[kOccluderCacheLights]{};  // PrimitiveKind; None = empty slot
+    uint32_t index[kOccluderCacheLights]{};
+    uint64_t queries{0};  // occlusion queries that consulted the cache
+    uint64_t hits{0};     // ... and were answered by the cached primitive alone
+};
+
+constexpr int kMaxPacketWidth = 8;
+
+// Up to kMaxPacketWidth rays in SoA form. Lanes whose bit is clear in
+// activeMask are masked off in every test and come back as misses.
+struct RayPacket {
+    alignas(32) float originX[kMaxPacketWidth];
+    alignas(32) float originY[kMaxPacketWidth];
+    alignas(32) float originZ[kMaxPacketWidth];
+    alignas(32) float dirX[kMaxPacketWidth];
+    alignas(32) float dirY[kMaxPacketWidth];
+    alignas(32) float dirZ[kMaxPacketWidth];
+    uint32_t activeMask{0};
+};
+
+// Per-lane closest hit. order == -1 means the lane hit nothing.
+struct PacketHits {
+    alignas(32) float t[kMaxPacketWidth];
+    alignas(32) int32_t order[kMaxPacketWidth];
+    alignas(32) uint32_t index[kMaxPacketWidth];
+    alignas(32) uint32_t kind[kMaxPacketWidth];  // PrimitiveKind
+};
+
+using ClosestHitFn = bool (*)(const GeometryView&, const float origin[3], const float dir[3], float tMin, float tMax,
+                              ScalarHit& outHit);
+// Any hit in [tMin, tMax]. cache may be null; light selects its slot.
+using OccludedFn = bool (*)(const GeometryView&, const float origin[3], const float dir[3], float tMin, float tMax,
+                            uint32_t ignoreKind, uint32_t ignoreIndex, OccluderCache* cache, uint32_t light);
+using PhongFn = void (*)(const GeometryView&, const LightView&, const PhongInput&, OccluderCache* cache,
+                         float inOutColor[3]);
+using ClosestHitPacketFn = void (*)(const GeometryView&, const RayPacket&, float tMin, float tMax, PacketHits&);
+
+// Post stage: linear HDR color to 8 bits. Values are scaled by exposure,
+// mapped into [0, 1] by toneMap (Clamp only clamps) and then either truncated
+// to 0..255 or, with an sRGB table, looked up through it.
+enum class ToneMap : uint32_t {
+    Clamp,
+    Reinhard,
+    Aces
+};
+
+constexpr uint32_t kSrgbTableSize = 4096;  // entry i = 8-bit sRGB of linear i / (size - 1)
+
+struct QuantizeParams {
+    float exposure{1.0f};
+    ToneMap toneMap{ToneMap::Clamp};
+    const uint8_t* srgbTable{nullptr};  // kSrgbTableSize entries, or null for linear output
+};
+
+using QuantizeFn = void (*)(const float* in, size_t count, const QuantizeParams&, uint8_t* out);
+
+enum class Isa {
+    Generic,
+    Sse42,
+    Avx2,
+    Avx512
+};
+
+// All variants compute bit-identical results; they only differ in speed.
+struct KernelTable {
+    Isa isa;
+    const char* name;
+    ClosestHitFn closestHit;
+    OccludedFn occluded;
+    PhongFn phong;
+    ClosestHitPacketFn closestHitPacket4;  // nullptr when the variant has no packet code
+    ClosestHitPacketFn closestHitPacket8;
+    QuantizeFn quantize;
+};
+
+bool isaSupported(Isa isa);
+const char* isaName(Isa isa);
+bool parseIsa(const std::string& name, Isa& outIsa);
+
+// The table in use: the best the CPU supports unless forceIsa() overrode it.
+const KernelTable& activeKernels();
+bool forceIsa(Isa isa);  // false (and no change) if the CPU cannot run it
+
+bool packetWidthSupported(int width);
+int widestPacketWidth();
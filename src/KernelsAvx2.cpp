@@ -0,0 +1,21 @@
+#include <Kernels.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+// See KernelsSse42.cpp for why this is a target attribute and not -mavx2.
+#define RT_KERNEL_TARGET __attribute__((target("avx2")))
+
+#include <SimdSse.inl>
+#include <SimdAvx2.inl>
+#define RT_KERNEL_PACKET4 SimdSse
+#define RT_KERNEL_PACKET8 SimdAvx2
+
+#include <KernelsImpl.inl>
+
+const KernelTable& kernelTableAvx2()
+{
+    static const KernelTable table = makeKernelTable(Isa::Avx2);
+    return table;
+}
+
+#endif
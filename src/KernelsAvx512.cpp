@@ -0,0 +1,23 @@
+#include <Kernels.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+// See KernelsSse42.cpp for why this is a target attribute and not -mavx512f.
+// The packets stay 8 wide; AVX-512VL lets the compiler use the extra registers
+// and mask instructions on them.
+#define RT_KERNEL_TARGET __attribute__((target("avx512f,avx512vl")))
+
+#include <SimdSse.inl>
+#include <SimdAvx2.inl>
+#define RT_KERNEL_PACKET4 SimdSse
+#define RT_KERNEL_PACKET8 SimdAvx2
+
+#include <KernelsImpl.inl>
+
+const KernelTable& kernelTableAvx512()
+{
+    static const KernelTable table = makeKernelTable(Isa::Avx512);
+    return table;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#include <Kernels.h>
+
+// Baseline build of the kernels: whatever the compiler targets by default
+// (SSE2 on x86-64, where the 4-wide packets need nothing more).
+#define RT_KERNEL_TARGET
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <SimdSse.inl>
+#define RT_KERNEL_PACKET4 SimdSse
+#endif
+
+#include <KernelsImpl.inl>
+
+const KernelTable& kernelTableGeneric()
+{
+    static const KernelTable table = makeKernelTable(Isa::Generic);
+    return table;
+}
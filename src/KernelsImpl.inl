@@ -0,0 +1,325 @@
+// Shared body of the Kernels<Isa>.cpp variants. Each includer defines
+// RT_KERNEL_TARGET (a target attribute, or nothing for the generic build) and
+// optionally RT_KERNEL_PACKET4 / RT_KERNEL_PACKET8 (SIMD traits types) first.
+//
+// Everything here has internal linkage and calls only code from this file, the
+// SIMD traits and compiler builtins. A shared inline function (glm, std::max,
+// std::sqrt, ...) would be emitted with this file's ISA and the linker could
+// keep that copy for the whole program, so none are used.
+//
+// The arithmetic repeats the glm expressions of the scalar path in the same
+// order; with -ffp-contract=off every variant rounds identically.
+
+#if defined(RT_KERNEL_PACKET4) || defined(RT_KERNEL_PACKET8)
+#include <PacketKernels.inl>
+#endif
+
+namespace {
+
+RT_KERNEL_TARGET inline bool sphereHit(const GeometryView& g, uint32_t i, const float* o, const float* d,
+                                       float tMin, float tMax, float& tHit)
+{
+    float ocx = o[0] - g.sphereX[i];
+    float ocy = o[1] - g.sphereY[i];
+    float ocz = o[2] - g.sphereZ[i];
+
+    float a = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+    float b = 2.0f * (ocx * d[0] + ocy * d[1] + ocz * d[2]);
+    float c = (ocx * ocx + ocy * ocy + ocz * ocz) - g.sphereRadiusSq[i];
+    float discriminant = b * b - 4.0f * a * c;
+    if (discriminant < 0.0f) {
+        return false;
+    }
+
+    float sqrtD = __builtin_sqrtf(discriminant);
+    float t = (-b - sqrtD) / (2.0f * a);
+    if (t < tMin || t > tMax) {
+        t = (-b + sqrtD) / (2.0f * a);
+        if (t < tMin || t > tMax) {
+            return false;
+        }
+    }
+    tHit = t;
+    return true;
+}
+
+RT_KERNEL_TARGET inline bool planeHit(const GeometryView& g, uint32_t i, const float* o, const float* d,
+                                      float tMin, float tMax, float& tHit)
+{
+    float denom = g.planeX[i] * d[0] + g.planeY[i] * d[1] + g.planeZ[i] * d[2];
+    if (__builtin_fabsf(denom) < 1e-6f) {
+        return false;
+    }
+
+    float t = -((g.planeX[i] * o[0] + g.planeY[i] * o[1] + g.planeZ[i] * o[2]) + g.planeD[i]) / denom;
+    if (t < tMin || t > tMax) {
+        return false;
+    }
+    tHit = t;
+    return true;
+}
+
+// Ray/box slab test: does the ray overlap the node's bounds within [tMin, tMax]?
+RT_KERNEL_TARGET inline bool slabHit(const BvhNode& node, const float* o, const float* invDir, float tMin, float tMax)
+{
+    const float mins[3] = {node.boundsMin.x, node.boundsMin.y, node.boundsMin.z};
+    const float maxs[3] = {node.boundsMax.x, node.boundsMax.y, node.boundsMax.z};
+    float tNear = tMin;
+    float tFar = tMax;
+    for (int axis = 0; axis < 3; ++axis) {
+        float t0 = (mins[axis] - o[axis]) * invDir[axis];
+        float t1 = (maxs[axis] - o[axis]) * invDir[axis];
+        if (t0 > t1) {
+            float tmp = t0;
+            t0 = t1;
+            t1 = tmp;
+        }
+        // Written so a NaN (origin on a slab of a zero-direction axis) never
+        // narrows the interval: the comparisons are simply false.
+        tNear = t0 > tNear ? t0 : tNear;
+        tFar = t1 < tFar ? t1 : tFar;
+    }
+    return tNear <= tFar;
+}
+
+RT_KERNEL_TARGET bool closestHitKernel(const GeometryView& g, const float* o, const float* d, float tMin, float tMax,
+                                       ScalarHit& outHit)
+{
+    float bestT = tMax;
+    int32_t bestOrder = -1;
+    uint32_t bestIndex = 0;
+    uint32_t bestKind = static_cast<uint32_t>(PrimitiveKind::None);
+    float t = 0.0f;
+
+    // Nearest hit wins; on an exact tie the primitive later in the file does.
+    for (uint32_t i = 0; i < g.planeCount; ++i) {
+        if (planeHit(g, i, o, d, tMin, bestT, t) &&
+            (t < bestT || static_cast<int32_t>(g.planeOrder[i]) > bestOrder)) {
+            bestT = t;
+            bestOrder = static_cast<int32_t>(g.planeOrder[i]);
+            bestIndex = i;
+            bestKind = static_cast<uint32_t>(PrimitiveKind::Plane);
+        }
+    }
+
+    if (g.nodeCount > 0) {
+        const float invDir[3] = {1.0f / d[0], 1.0f / d[1], 1.0f / d[2]};
+        uint32_t stack[Bvh::kMaxDepth];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0) {
+            const BvhNode& node = g.nodes[stack[--stackSize]];
+            if (!slabHit(node, o, invDir, tMin, bestT)) {
+                continue;
+            }
+            if (node.primCount == 0) {
+                stack[stackSize++] = node.leftOrFirst + 1;
+                stack[stackSize++] = node.leftOrFirst;
+                continue;
+            }
+            for (uint32_t k = 0; k < node.primCount; ++k) {
+                uint32_t i = g.primIndices[node.leftOrFirst + k];
+                if (sphereHit(g, i, o, d, tMin, bestT, t) &&
+                    (t < bestT || static_cast<int32_t>(g.sphereOrder[i]) > bestOrder)) {
+                    bestT = t;
+                    bestOrder = static_cast<int32_t>(g.sphereOrder[i]);
+                    bestIndex = i;
+                    bestKind = static_cast<uint32_t>(PrimitiveKind::Sphere);
+                }
+            }
+        }
+    }
+
+    outHit.t = bestT;
+    outHit.order = bestOrder;
+    outHit.index = bestIndex;
+    outHit.kind = bestKind;
+    return bestOrder >= 0;
+}
+
+// Only answers whether anything blocks the segment: no normals, no materials,
+// and the first blocker found ends the search.
+RT_KERNEL_TARGET bool occludedKernel(const GeometryView& g, const float* o, const float* d, float tMin, float tMax,
+                                     uint32_t ignoreKind, uint32_t ignoreIndex, OccluderCache* cache, uint32_t light)
+{
+    float t = 0.0f;
+    const uint32_t planeKind = static_cast<uint32_t>(PrimitiveKind::Plane);
+    const uint32_t sphereKind = static_cast<uint32_t>(PrimitiveKind::Sphere);
+    const bool ignorePlane = ignoreKind == planeKind;
+    const bool ignoreSphere = ignoreKind == sphereKind;
+
+    const bool cached = cache != nullptr && light < kOccluderCacheLights;
+    if (cached) {
+        ++cache->queries;
+        uint32_t kind = cache->kind[light];
+        uint32_t index = cache->index[light];
+        bool blocked = false;
+        if (kind == sphereKind) {
+            blocked = !(ignoreSphere && index == ignoreIndex) && sphereHit(g, index, o, d, tMin, tMax, t);
+        } else if (kind == planeKind) {
+            blocked = !(ignorePlane && index == ignoreIndex) && planeHit(g, index, o, d, tMin, tMax, t);
+        }
+        if (blocked) {
+            ++cache->hits;
+            return true;
+        }
+    }
+
+    for (uint32_t i = 0; i < g.planeCount; ++i) {
+        if (!(ignorePlane && i == ignoreIndex) && planeHit(g, i, o, d, tMin, tMax, t)) {
+            if (cached) {
+                cache->kind[light] = planeKind;
+                cache->index[light] = i;
+            }
+            return true;
+        }
+    }
+
+    if (g.nodeCount == 0) {
+        return false;
+    }
+    const float invDir[3] = {1.0f / d[0], 1.0f / d[1], 1.0f / d[2]};
+    uint32_t stack[Bvh::kMaxDepth];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const BvhNode& node = g.nodes[stack[--stackSize]];
+        if (!slabHit(node, o, invDir, tMin, tMax)) {
+            continue;
+        }
+        if (node.primCount == 0) {
+            stack[stackSize++] = node.leftOrFirst + 1;
+            stack[stackSize++] = node.leftOrFirst;
+            continue;
+        }
+        for (uint32_t k = 0; k < node.primCount; ++k) {
+            uint32_t i = g.primIndices[node.leftOrFirst + k];
+            if (!(ignoreSphere && i == ignoreIndex) && sphereHit(g, i, o, d, tMin, tMax, t)) {
+                if (cached) {
+                    cache->kind[light] = sphereKind;
+                    cache->index[light] = i;
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// The light loop of RayTracer::shade: spot cone test, shadow ray, Lambert and
+// Phong terms, accumulated into inOutColor (which holds the ambient term).
+RT_KERNEL_TARGET void phongKernel(const GeometryView& g, const LightView& lights, const PhongInput& in,
+                                  OccluderCache* cache, float* inOutColor)
+{
+    const float* p = in.point;
+    const float* n = in.normal;
+    const float* v = in.viewDir;
+
+    for (uint32_t k = 0; k < lights.count; ++k) {
+        float L[3];
+        float maxDist = __builtin_inff();
+        if (lights.isSpot[k]) {
+            float toLight[3] = {lights.posX[k] - p[0], lights.posY[k] - p[1], lights.posZ[k] - p[2]};
+            maxDist = __builtin_sqrtf(toLight[0] * toLight[0] + toLight[1] * toLight[1] + toLight[2] * toLight[2]);
+            if (maxDist <= 0.0f) {
+                continue;
+            }
+            L[0] = toLight[0] / maxDist;
+            L[1] = toLight[1] / maxDist;
+            L[2] = toLight[2] / maxDist;
+
+            float spotCos = lights.dirX[k] * -L[0] + lights.dirY[k] * -L[1] + lights.dirZ[k] * -L[2];
+            if (spotCos < lights.cutoff[k]) {
+                continue;
+            }
+        } else {
+            L[0] = lights.dirX[k];
+            L[1] = lights.dirY[k];
+            L[2] = lights.dirZ[k];
+        }
+
+        const float shadowOrigin[3] = {p[0] + L[0] * in.epsilon, p[1] + L[1] * in.epsilon, p[2] + L[2] * in.epsilon};
+        if (occludedKernel(g, shadowOrigin, L, in.epsilon, maxDist - in.epsilon, in.ignoreKind, in.ignoreIndex, cache,
+                           k)) {
+            continue;
+        }
+
+        float diff = n[0] * L[0] + n[1] * L[1] + n[2] * L[2];
+        diff = diff < 0.0f ? 0.0f : diff;
+
+        // glm::reflect(-L, n) = I - n * dot(n, I) * 2
+        float I[3] = {-L[0], -L[1], -L[2]};
+        float nDotI = n[0] * I[0] + n[1] * I[1] + n[2] * I[2];
+        float r[3] = {I[0] - n[0] * nDotI * 2.0f, I[1] - n[1] * nDotI * 2.0f, I[2] - n[2] * nDotI * 2.0f};
+        float vDotR = v[0] * r[0] + v[1] * r[1] + v[2] * r[2];
+        float spec = __builtin_powf(vDotR < 0.0f ? 0.0f : vDotR, in.shininess);
+
+        const float intensity[3] = {lights.intensityR[k], lights.intensityG[k], lights.intensityB[k]};
+        for (int c = 0; c < 3; ++c) {
+            float diffuse = in.baseColor[c] * intensity[c] * diff;
+            float specular = in.specular[c] * intensity[c] * spec;
+            inOutColor[c] += diffuse + specular;
+        }
+    }
+}
+
+// GCC vector extensions, as wide as this file's ISA has registers for.
+#ifdef RT_KERNEL_PACKET8
+constexpr size_t kQuantizeLanes = 8;
+#else
+constexpr size_t kQuantizeLanes = 4;
+#endif
+typedef float QuantizeFloats __attribute__((vector_size(kQuantizeLanes * sizeof(float))));
+typedef int32_t QuantizeInts __attribute__((vector_size(kQuantizeLanes * sizeof(int32_t))));
+
+// Tone maps and clamps v into [0, 1]. Written once for scalars and vectors
+// so the tail of a run rounds exactly like the vector body. The clamp is
+// glm::clamp(v, 0, 1) for every non-NaN v; NaN becomes 0.
+template <typename T>
+RT_KERNEL_TARGET inline T toneMapped(T v, float exposure, ToneMap toneMap)
+{
+    v = v * exposure;
+    if (toneMap == ToneMap::Reinhard) {
+        v = v / (1.0f + v);
+    } else if (toneMap == ToneMap::Aces) {
+        // Narkowicz's fit of the ACES filmic curve
+        v = (v * (2.51f * v + 0.03f)) / (v * (2.43f * v + 0.59f) + 0.14f);
+    }
+    v = v > 0.0f ? v : 0.0f;
+    return v < 1.0f ? v : 1.0f;
+}
+
+RT_KERNEL_TARGET void quantizeKernel(const float* in, size_t count, const QuantizeParams& params, uint8_t* out)
+{
+    const float scale = params.srgbTable ? static_cast<float>(kSrgbTableSize - 1) : 255.0f;
+    const float bias = params.srgbTable ? 0.5f : 0.0f;  // table: nearest entry; linear: truncate like static_cast
+    size_t i = 0;
+    for (; i + kQuantizeLanes <= count; i += kQuantizeLanes) {
+        QuantizeFloats v;
+        __builtin_memcpy(&v, in + i, sizeof(v));
+        QuantizeFloats mapped = toneMapped(v, params.exposure, params.toneMap);
+        QuantizeInts q = __builtin_convertvector(mapped * scale + bias, QuantizeInts);
+        for (size_t lane = 0; lane < kQuantizeLanes; ++lane) {
+            out[i + lane] = params.srgbTable ? params.srgbTable[q[lane]] : static_cast<uint8_t>(q[lane]);
+        }
+    }
+    for (; i < count; ++i) {
+        int32_t q = static_cast<int32_t>(toneMapped(in[i], params.exposure, params.toneMap) * scale + bias);
+        out[i] = params.srgbTable ? params.srgbTable[q] : static_cast<uint8_t>(q);
+    }
+}
+
+KernelTable makeKernelTable(Isa isa)
+{
+    KernelTable table{isa,    isaName(isa), closestHitKernel, occludedKernel, phongKernel, nullptr, nullptr,
+                      quantizeKernel};
+#ifdef RT_KERNEL_PACKET4
+    table.closestHitPacket4 = closestHitPacket<RT_KERNEL_PACKET4>;
+#endif
+#ifdef RT_KERNEL_PACKET8
+    table.closestHitPacket8 = closestHitPacket<RT_KERNEL_PACKET8>;
+#endif
+    return table;
+}
+
+}  // namespace
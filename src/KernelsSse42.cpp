@@ -0,0 +1,21 @@
+#include <Kernels.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+// Compiled per function for the target ISA rather than with -m flags on the
+// file, so nothing outside these kernels can pick up instructions the CPU may
+// lack. Only called after isaSupported() confirmed the CPU runs it.
+#define RT_KERNEL_TARGET __attribute__((target("sse4.2")))
+
+#include <SimdSse.inl>
+#define RT_KERNEL_PACKET4 SimdSse
+
+#include <KernelsImpl.inl>
+
+const KernelTable& kernelTableSse42()
+{
+    static const KernelTable table = makeKernelTable(Isa::Sse42);
+    return table;
+}
+
+#endif
@@ -0,0 +1,114 @@
+#include <MappedFile.h>
+
+#include <utility>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        // A moved vector keeps its storage, so m_Data stays valid either way.
+        m_Data = other.m_Data;
+        m_Size = other.m_Size;
+        m_Mapped = other.m_Mapped;
+        m_Buffer = std::move(other.m_Buffer);
+        other.m_Data = nullptr;
+        other.m_Size = 0;
+        other.m_Mapped = false;
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path, Access access)
+{
+    close();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    m_Size = static_cast<size_t>(st.st_size);
+    if (m_Size > 0) {
+        void* mapped = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            m_Size = 0;
+            return false;
+        }
+        m_Data = static_cast<const char*>(mapped);
+        m_Mapped = true;
+        advise(access);
+    }
+    ::close(fd);  // the mapping stays valid
+    return true;
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) {
+        return false;
+    }
+    m_Buffer.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    if (!in.read(m_Buffer.data(), static_cast<std::streamsize>(m_Buffer.size()))) {
+        m_Buffer.clear();
+        return false;
+    }
+    m_Data = m_Buffer.data();
+    m_Size = m_Buffer.size();
+    return true;
+#endif
+}
+
+void MappedFile::advise(Access access)
+{
+#ifndef _WIN32
+    if (m_Mapped) {
+        madvise(const_cast<char*>(m_Data), m_Size, access == Access::Random ? MADV_RANDOM : MADV_SEQUENTIAL);
+    }
+#else
+    (void)access;
+#endif
+}
+
+void MappedFile::assign(const char* data, size_t size)
+{
+    close();
+    m_Buffer.assign(data, data + size);
+    m_Data = m_Buffer.data();
+    m_Size = m_Buffer.size();
+}
+
+void MappedFile::close()
+{
+#ifndef _WIN32
+    if (m_Mapped) {
+        munmap(const_cast<char*>(m_Data), m_Size);
+    }
+#endif
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Mapped = false;
+    m_Buffer.clear();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. Uses mmap where available; elsewhere the
+// file is read into memory once, which keeps the same interface.
+class MappedFile {
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // How the mapping will be read, passed to the kernel as a paging hint.
+    enum class Access {
+        Sequential,  // front to back once, as the text parser and checkpoints do
+        Random,      // scattered reads for as long as it is open, as rendering does
+    };
+
+    bool open(const std::string& path, Access access = Access::Sequential);
+    // Changes the hint for a file already open, for callers that only learn
+    // how it will be read from its contents.
+    void advise(Access access);
+    // Holds a private copy of data instead of a file, for callers that
+    // already have the contents in memory.
+    void assign(const char* data, size_t size);
+    void close();
+
+    const char* data() const { return m_Data; }
+    size_t size() const { return m_Size; }
+
+  private:
+    const char* m_Data{nullptr};
+    size_t m_Size{0};
+    bool m_Mapped{false};
+    std::vector<char> m_Buffer;  // fallback storage when the file is not mapped
+};
@@ -0,0 +1,211 @@
+// Width-generic packet kernels, included through KernelsImpl.inl by the
+// Kernels<Isa>.cpp files once their SIMD traits types are defined.
+//
+// Every operation mirrors the scalar intersectSphere/intersectPlane/slab test
+// in the same order, so each lane rounds exactly like the scalar path.
+
+namespace {
+
+template <typename S>
+struct PacketLanes {
+    typename S::F ox, oy, oz;
+    typename S::F dx, dy, dz;
+    typename S::F invX, invY, invZ;
+    typename S::F active;  // all-ones in lanes that carry a ray
+};
+
+template <typename S>
+struct PacketState {
+    typename S::F t;
+    typename S::I order;
+    typename S::I index;
+    typename S::I kind;
+};
+
+template <typename S>
+RT_KERNEL_TARGET void intersectSpherePacket(const GeometryView& g, uint32_t i, const PacketLanes<S>& r,
+                                          typename S::F tMin, PacketState<S>& st)
+{
+    using F = typename S::F;
+    F ocx = S::sub(r.ox, S::set1(g.sphereX[i]));
+    F ocy = S::sub(r.oy, S::set1(g.sphereY[i]));
+    F ocz = S::sub(r.oz, S::set1(g.sphereZ[i]));
+
+    F a = S::add(S::add(S::mul(r.dx, r.dx), S::mul(r.dy, r.dy)), S::mul(r.dz, r.dz));
+    F b = S::mul(S::set1(2.0f), S::add(S::add(S::mul(ocx, r.dx), S::mul(ocy, r.dy)), S::mul(ocz, r.dz)));
+    F c = S::sub(S::add(S::add(S::mul(ocx, ocx), S::mul(ocy, ocy)), S::mul(ocz, ocz)), S::set1(g.sphereRadiusSq[i]));
+    F discriminant = S::sub(S::mul(b, b), S::mul(S::mul(S::set1(4.0f), a), c));
+
+    F candidate = S::andMask(r.active, S::notLessMask(discriminant, S::set1(0.0f)));
+    if (S::movemask(candidate) == 0) {
+        return;
+    }
+
+    F sqrtD = S::sqrt(discriminant);
+    F negB = S::neg(b);
+    F twoA = S::mul(S::set1(2.0f), a);
+    F t0 = S::div(S::sub(negB, sqrtD), twoA);
+    F t1 = S::div(S::add(negB, sqrtD), twoA);
+    F in0 = S::notMask(S::orMask(S::lessMask(t0, tMin), S::greaterMask(t0, st.t)));
+    F in1 = S::notMask(S::orMask(S::lessMask(t1, tMin), S::greaterMask(t1, st.t)));
+    F t = S::blend(t1, t0, in0);
+
+    typename S::I order = S::set1i(static_cast<int32_t>(g.sphereOrder[i]));
+    F better = S::orMask(S::lessMask(t, st.t), S::greaterMaskI(order, st.order));
+    F take = S::andMask(S::andMask(candidate, S::orMask(in0, in1)), better);
+    if (S::movemask(take) == 0) {
+        return;
+    }
+
+    st.t = S::blend(st.t, t, take);
+    st.order = S::blendi(st.order, order, take);
+    st.index = S::blendi(st.index, S::set1i(static_cast<int32_t>(i)), take);
+    st.kind = S::blendi(st.kind, S::set1i(static_cast<int32_t>(PrimitiveKind::Sphere)), take);
+}
+
+template <typename S>
+RT_KERNEL_TARGET void intersectPlanePacket(const GeometryView& g, uint32_t i, const PacketLanes<S>& r,
+                                         typename S::F tMin, PacketState<S>& st)
+{
+    using F = typename S::F;
+    F nx = S::set1(g.planeX[i]);
+    F ny = S::set1(g.planeY[i]);
+    F nz = S::set1(g.planeZ[i]);
+
+    F denom = S::add(S::add(S::mul(nx, r.dx), S::mul(ny, r.dy)), S::mul(nz, r.dz));
+    F facing = S::notMask(S::lessMask(S::abs(denom), S::set1(1e-6f)));
+
+    F dist = S::add(S::add(S::add(S::mul(nx, r.ox), S::mul(ny, r.oy)), S::mul(nz, r.oz)), S::set1(g.planeD[i]));
+    F t = S::div(S::neg(dist), denom);
+    F inRange = S::notMask(S::orMask(S::lessMask(t, tMin), S::greaterMask(t, st.t)));
+
+    typename S::I order = S::set1i(static_cast<int32_t>(g.planeOrder[i]));
+    F better = S::orMask(S::lessMask(t, st.t), S::greaterMaskI(order, st.order));
+    F take = S::andMask(S::andMask(S::andMask(r.active, facing), inRange), better);
+    if (S::movemask(take) == 0) {
+        return;
+    }
+
+    st.t = S::blend(st.t, t, take);
+    st.order = S::blendi(st.order, order, take);
+    st.index = S::blendi(st.index, S::set1i(static_cast<int32_t>(i)), take);
+    st.kind = S::blendi(st.kind, S::set1i(static_cast<int32_t>(PrimitiveKind::Plane)), take);
+}
+
+// Packet version of slabHit (KernelsImpl.inl): returns the lanes whose ray overlaps the
+// node within [tMin, current closest t], and their entry distances.
+template <typename S>
+RT_KERNEL_TARGET typename S::F slabPacket(const BvhNode& node, const PacketLanes<S>& r, typename S::F tMin,
+                                        typename S::F tMax, typename S::F& tEntry)
+{
+    using F = typename S::F;
+    F tNear = tMin;
+    F tFar = tMax;
+
+    const float mins[3] = {node.boundsMin.x, node.boundsMin.y, node.boundsMin.z};
+    const float maxs[3] = {node.boundsMax.x, node.boundsMax.y, node.boundsMax.z};
+    const F origins[3] = {r.ox, r.oy, r.oz};
+    const F invs[3] = {r.invX, r.invY, r.invZ};
+    for (int axis = 0; axis < 3; ++axis) {
+        F t0 = S::mul(S::sub(S::set1(mins[axis]), origins[axis]), invs[axis]);
+        F t1 = S::mul(S::sub(S::set1(maxs[axis]), origins[axis]), invs[axis]);
+        F swap = S::greaterMask(t0, t1);
+        F lo = S::blend(t0, t1, swap);
+        F hi = S::blend(t1, t0, swap);
+        tNear = S::blend(tNear, lo, S::greaterMask(lo, tNear));
+        tFar = S::blend(tFar, hi, S::lessMask(hi, tFar));
+    }
+    tEntry = tNear;
+    return S::andMask(r.active, S::notMask(S::greaterMask(tNear, tFar)));
+}
+
+template <typename S>
+RT_KERNEL_TARGET void closestHitPacket(const GeometryView& g, const RayPacket& packet, float tMinScalar,
+                                     float tMaxScalar, PacketHits& hits)
+{
+    using F = typename S::F;
+    PacketLanes<S> r;
+    r.ox = S::load(packet.originX);
+    r.oy = S::load(packet.originY);
+    r.oz = S::load(packet.originZ);
+    r.dx = S::load(packet.dirX);
+    r.dy = S::load(packet.dirY);
+    r.dz = S::load(packet.dirZ);
+    F one = S::set1(1.0f);
+    r.invX = S::div(one, r.dx);
+    r.invY = S::div(one, r.dy);
+    r.invZ = S::div(one, r.dz);
+    r.active = S::laneMask(packet.activeMask);
+
+    PacketState<S> st;
+    st.t = S::set1(tMaxScalar);
+    st.order = S::set1i(-1);
+    st.index = S::set1i(0);
+    st.kind = S::set1i(static_cast<int32_t>(PrimitiveKind::None));
+    F tMin = S::set1(tMinScalar);
+
+    for (uint32_t i = 0; i < g.planeCount; ++i) {
+        intersectPlanePacket<S>(g, i, r, tMin, st);
+    }
+
+    if (g.nodeCount > 0) {
+        uint32_t stack[Bvh::kMaxDepth];
+        int stackSize = 0;
+        F entry;
+        uint32_t nodeIndex = 0;
+        bool visit = S::movemask(slabPacket<S>(g.nodes[0], r, tMin, st.t, entry)) != 0;
+
+        while (true) {
+            if (visit) {
+                const BvhNode& node = g.nodes[nodeIndex];
+                if (node.primCount != 0) {
+                    for (uint32_t k = 0; k < node.primCount; ++k) {
+                        intersectSpherePacket<S>(g, g.primIndices[node.leftOrFirst + k], r, tMin, st);
+                    }
+                } else {
+                    uint32_t near = node.leftOrFirst;
+                    uint32_t far = near + 1;
+                    F entryNear;
+                    F entryFar;
+                    F maskNear = slabPacket<S>(g.nodes[near], r, tMin, st.t, entryNear);
+                    F maskFar = slabPacket<S>(g.nodes[far], r, tMin, st.t, entryFar);
+                    int bitsNear = S::movemask(maskNear);
+                    int bitsFar = S::movemask(maskFar);
+                    if (bitsNear != 0 && bitsFar != 0) {
+                        // Lanes vote on which child is closer; order only affects speed.
+                        int farFirst = S::movemask(S::andMask(S::andMask(maskNear, maskFar),
+                                                              S::lessMask(entryFar, entryNear)));
+                        int nearFirst = S::movemask(S::andMask(S::andMask(maskNear, maskFar),
+                                                               S::lessMask(entryNear, entryFar)));
+                        if (__builtin_popcount(farFirst) > __builtin_popcount(nearFirst)) {
+                            uint32_t tmp = near;
+                            near = far;
+                            far = tmp;
+                        }
+                        stack[stackSize++] = far;
+                        nodeIndex = near;
+                        continue;
+                    }
+                    if (bitsNear != 0 || bitsFar != 0) {
+                        nodeIndex = bitsNear != 0 ? near : far;
+                        continue;
+                    }
+                }
+            }
+
+            if (stackSize == 0) {
+                break;
+            }
+            nodeIndex = stack[--stackSize];
+            // Re-test: the closest hits may have moved in since the push.
+            visit = S::movemask(slabPacket<S>(g.nodes[nodeIndex], r, tMin, st.t, entry)) != 0;
+        }
+    }
+
+    S::store(hits.t, st.t);
+    S::storei(hits.order, st.order);
+    S::storei(reinterpret_cast<int32_t*>(hits.index), st.index);
+    S::storei(reinterpret_cast<int32_t*>(hits.kind), st.kind);
+}
+
+}  // namespace
@@ -0,0 +1,281 @@
+#include <PngWriter.h>
+#include <ThreadPool.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr int kChannels = 3;
+    constexpr size_t kChunkBytes = 128 * 1024;  // filtered bytes per deflate chunk, as in pigz
+    constexpr uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    uint8_t paeth(int a, int b, int c)
+    {
+        // |p - a|, |p - b| and |p - c| for p = a + b - c, written as selects
+        // so the filter loops vectorize.
+        int pa = std::abs(b - c);
+        int pb = std::abs(a - c);
+        int pc = std::abs(a + b - 2 * c);
+        int bc = pb <= pc ? b : c;
+        return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : bc);
+    }
+
+    // PNG filter types: 0 none, 1 sub, 2 up, 3 average, 4 paeth. a, b and c
+    // are the bytes left of, above, and above-left of the one being filtered.
+    template <int Type>
+    uint8_t filtered(int x, int a, int b, int c)
+    {
+        switch (Type) {
+            case 1:
+                return static_cast<uint8_t>(x - a);
+            case 2:
+                return static_cast<uint8_t>(x - b);
+            case 3:
+                return static_cast<uint8_t>(x - ((a + b) >> 1));
+            case 4:
+                return static_cast<uint8_t>(x - paeth(a, b, c));
+            default:
+                return static_cast<uint8_t>(x);
+        }
+    }
+
+    // Calls emit(i, filtered byte) for every byte of row. The first pixel
+    // has no left neighbour, so it is kept out of the main loop.
+    template <int Type, typename Emit>
+    void filterBytes(const uint8_t* row, const uint8_t* prev, size_t rowBytes, Emit&& emit)
+    {
+        const size_t head = std::min(rowBytes, static_cast<size_t>(kChannels));
+        for (size_t i = 0; i < head; ++i) {
+            emit(i, filtered<Type>(row[i], 0, prev[i], 0));
+        }
+        for (size_t i = head; i < rowBytes; ++i) {
+            emit(i, filtered<Type>(row[i], row[i - kChannels], prev[i], prev[i - kChannels]));
+        }
+    }
+
+    // Sum of the absolute signed bytes row filters to with Type.
+    template <int Type>
+    long filterCost(const uint8_t* row, const uint8_t* prev, size_t rowBytes)
+    {
+        long cost = 0;
+        filterBytes<Type>(row, prev, rowBytes,
+                          [&](size_t, uint8_t value) { cost += std::abs(static_cast<int>(static_cast<int8_t>(value))); });
+        return cost;
+    }
+
+    template <int Type>
+    void filterInto(const uint8_t* row, const uint8_t* prev, size_t rowBytes, uint8_t* out)
+    {
+        filterBytes<Type>(row, prev, rowBytes, [&](size_t i, uint8_t value) { out[i] = value; });
+    }
+
+    // Same heuristic as stb_image_write: the filter whose output has the
+    // smallest sum of absolute (signed) bytes usually deflates best.
+    void filterRow(const uint8_t* row, const uint8_t* prev, size_t rowBytes, uint8_t* out)
+    {
+        const long costs[5] = {filterCost<0>(row, prev, rowBytes), filterCost<1>(row, prev, rowBytes),
+                               filterCost<2>(row, prev, rowBytes), filterCost<3>(row, prev, rowBytes),
+                               filterCost<4>(row, prev, rowBytes)};
+        const int bestType = static_cast<int>(std::min_element(costs, costs + 5) - costs);  // first of equals
+        out[0] = static_cast<uint8_t>(bestType);
+        switch (bestType) {
+            case 0:
+                filterInto<0>(row, prev, rowBytes, out + 1);
+                break;
+            case 1:
+                filterInto<1>(row, prev, rowBytes, out + 1);
+                break;
+            case 2:
+                filterInto<2>(row, prev, rowBytes, out + 1);
+                break;
+            case 3:
+                filterInto<3>(row, prev, rowBytes, out + 1);
+                break;
+            default:
+                filterInto<4>(row, prev, rowBytes, out + 1);
+                break;
+        }
+    }
+
+    void putBigEndian(uint8_t* out, uint32_t value)
+    {
+        out[0] = static_cast<uint8_t>(value >> 24);
+        out[1] = static_cast<uint8_t>(value >> 16);
+        out[2] = static_cast<uint8_t>(value >> 8);
+        out[3] = static_cast<uint8_t>(value);
+    }
+}
+
+bool PngStreamWriter::open(const std::string& path, int width, int height)
+{
+    m_Path = path;
+    if (width <= 0 || height <= 0) {
+        return fail("invalid image size");
+    }
+    m_Out.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_Out.is_open()) {
+        return fail("cannot open file for writing");
+    }
+    m_Width = width;
+    m_Height = height;
+    m_RowsWritten = 0;
+    m_Adler = 1;
+    m_PrevRow.assign(static_cast<size_t>(width) * kChannels, 0);
+    m_Filtered.clear();
+    m_WindowSize = 0;
+    m_StreamStarted = false;
+
+    m_Out.write(reinterpret_cast<const char*>(kSignature), sizeof(kSignature));
+    uint8_t header[13];
+    putBigEndian(header, static_cast<uint32_t>(width));
+    putBigEndian(header + 4, static_cast<uint32_t>(height));
+    header[8] = 8;   // bit depth
+    header[9] = 2;   // truecolor
+    header[10] = 0;  // deflate
+    header[11] = 0;  // adaptive filtering
+    header[12] = 0;  // no interlace
+    return writeChunk("IHDR", header, sizeof(header));
+}
+
+bool PngStreamWriter::writeRows(const unsigned char* rows, int rowCount)
+{
+    if (!m_Out.is_open()) {
+        return fail("not open");
+    }
+    if (rowCount <= 0 || rowCount > m_Height - m_RowsWritten) {
+        return fail("more rows than the image height");
+    }
+
+    const size_t rowBytes = static_cast<size_t>(m_Width) * kChannels;
+    const size_t filteredRowBytes = rowBytes + 1;
+    const int rowsPerChunk = static_cast<int>(std::max<size_t>(1, kChunkBytes / filteredRowBytes));
+    const bool final = m_RowsWritten + rowCount == m_Height;
+    m_Filtered.resize(m_WindowSize + filteredRowBytes * rowCount);
+    m_Chunks.resize((rowCount + rowsPerChunk - 1) / rowsPerChunk);
+    for (size_t i = 0; i < m_Chunks.size(); ++i) {
+        m_Chunks[i].firstRow = static_cast<int>(i) * rowsPerChunk;
+        m_Chunks[i].rowCount = std::min(rowsPerChunk, rowCount - m_Chunks[i].firstRow);
+    }
+
+    // Filtering only looks at the unfiltered rows, so all chunks go at once.
+    forEachChunk(m_Chunks.size(), [&](size_t i) {
+        EncodedChunk& chunk = m_Chunks[i];
+        uint8_t* out = m_Filtered.data() + m_WindowSize + filteredRowBytes * chunk.firstRow;
+        for (int r = chunk.firstRow; r < chunk.firstRow + chunk.rowCount; ++r) {
+            const uint8_t* row = rows + rowBytes * r;
+            const uint8_t* prev = r == 0 ? m_PrevRow.data() : row - rowBytes;
+            filterRow(row, prev, rowBytes, out + filteredRowBytes * (r - chunk.firstRow));
+        }
+        chunk.adler = adler32(1, out, filteredRowBytes * chunk.rowCount);
+    });
+    for (const EncodedChunk& chunk : m_Chunks) {
+        m_Adler = adler32Combine(m_Adler, chunk.adler, filteredRowBytes * chunk.rowCount);
+    }
+    std::memcpy(m_PrevRow.data(), rows + rowBytes * (rowCount - 1), rowBytes);
+    m_RowsWritten += rowCount;
+
+    // Deflate needs the filtered bytes before each chunk as its dictionary,
+    // so it starts once the whole band is filtered.
+    forEachChunk(m_Chunks.size(), [&](size_t i) { encodeChunk(m_Chunks[i], final, i + 1 == m_Chunks.size()); });
+    m_StreamStarted = true;
+
+    bool ok = true;
+    for (EncodedChunk& chunk : m_Chunks) {
+        m_Out.write(reinterpret_cast<const char*>(chunk.bytes.data()), static_cast<std::streamsize>(chunk.bytes.size()));
+        chunk.bytes.clear();
+    }
+    if (!m_Out.good()) {
+        ok = fail("write failed");
+    }
+
+    // Keep the tail of the band as the dictionary for the next one.
+    size_t keep = std::min(m_Filtered.size(), kDeflateWindow);
+    std::memmove(m_Filtered.data(), m_Filtered.data() + m_Filtered.size() - keep, keep);
+    m_Filtered.resize(keep);
+    m_WindowSize = keep;
+    return ok;
+}
+
+bool PngStreamWriter::close()
+{
+    if (!m_Out.is_open()) {
+        return fail("not open");
+    }
+    bool complete = m_RowsWritten == m_Height;
+    if (complete) {
+        complete = writeChunk("IEND", nullptr, 0);
+    } else {
+        fail("only " + std::to_string(m_RowsWritten) + " of " + std::to_string(m_Height) + " rows written");
+    }
+    m_Out.close();
+    m_Filtered = {};
+    m_Chunks = {};
+    return complete && !m_Out.fail();
+}
+
+void PngStreamWriter::forEachChunk(size_t count, const std::function<void(size_t)>& fn) const
+{
+    if (m_Pool) {
+        m_Pool->parallelFor(count, fn);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        fn(i);
+    }
+}
+
+void PngStreamWriter::encodeChunk(EncodedChunk& chunk, bool final, bool last)
+{
+    const size_t filteredRowBytes = static_cast<size_t>(m_Width) * kChannels + 1;
+    const size_t start = m_WindowSize + filteredRowBytes * chunk.firstRow;
+    const size_t dictionarySize = std::min(start, kDeflateWindow);
+    const bool streamStart = !m_StreamStarted && chunk.firstRow == 0;
+
+    // Laid out as a complete IDAT chunk: length, type, data, CRC.
+    std::vector<uint8_t>& bytes = chunk.bytes;
+    bytes.assign({0, 0, 0, 0, 'I', 'D', 'A', 'T'});
+    if (streamStart) {
+        bytes.push_back(0x78);  // zlib header: deflate, 32 KiB window
+        bytes.push_back(zlibHeaderFlags(m_Level));
+    }
+    deflateChunk(m_Filtered.data() + start - dictionarySize, dictionarySize, filteredRowBytes * chunk.rowCount,
+                 final && last, m_Level, bytes);
+    if (final && last) {
+        uint8_t trailer[4];
+        putBigEndian(trailer, m_Adler);
+        bytes.insert(bytes.end(), trailer, trailer + 4);
+    }
+    putBigEndian(bytes.data(), static_cast<uint32_t>(bytes.size() - 8));
+    uint8_t crc[4];
+    putBigEndian(crc, crc32(0, bytes.data() + 4, bytes.size() - 4));
+    bytes.insert(bytes.end(), crc, crc + 4);
+}
+
+bool PngStreamWriter::writeChunk(const char type[4], const uint8_t* data, size_t size)
+{
+    uint8_t prefix[8];
+    putBigEndian(prefix, static_cast<uint32_t>(size));
+    std::memcpy(prefix + 4, type, 4);
+    uint32_t crc = crc32(0, prefix + 4, 4);
+    crc = crc32(crc, data, size);
+    uint8_t suffix[4];
+    putBigEndian(suffix, crc);
+
+    m_Out.write(reinterpret_cast<const char*>(prefix), sizeof(prefix));
+    if (size > 0) {
+        m_Out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+    m_Out.write(reinterpret_cast<const char*>(suffix), sizeof(suffix));
+    if (!m_Out.good()) {
+        return fail("write failed");
+    }
+    return true;
+}
+
+bool PngStreamWriter::fail(const std::string& message)
+{
+    std::cerr << "Failed to write image: " << m_Path << " (" << message << ")" << std::endl;
+    return false;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Deflate.h>
+#include <ImageWriter.h>
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Writes an 8-bit RGB PNG a band of rows at a time. Each band is filtered,
+// deflated and written out as its own IDAT chunk before writeRows returns;
+// besides the caller's band, only the previous row and the 32 KiB deflate
+// window are kept, so memory does not grow with the image height.
+//
+// With a thread pool, a band is cut into row-aligned chunks that are filtered
+// and deflated on separate threads, pigz style: every chunk uses the 32 KiB
+// before it as its dictionary and ends in a sync flush, so the chunks
+// concatenate into one ordinary zlib stream and the file reads like any
+// other PNG.
+class PngStreamWriter : public ImageStreamWriter {
+  public:
+    PngStreamWriter() = default;
+
+    PngStreamWriter(const PngStreamWriter&) = delete;
+    PngStreamWriter& operator=(const PngStreamWriter&) = delete;
+
+    // Both take effect at the next open. Level: 0 (store) to 9 (smallest).
+    void setLevel(int level) { m_Level = level; }
+    void setThreadPool(ThreadPool* pool) { m_Pool = pool; }
+
+    bool open(const std::string& path, int width, int height) override;
+    bool writeRows(const unsigned char* rows, int rowCount) override;
+    bool close() override;
+
+  private:
+    // One deflate chunk of a band, ready to be written as an IDAT chunk.
+    struct EncodedChunk {
+        int firstRow{0};  // within the band
+        int rowCount{0};
+        uint32_t adler{1};
+        std::vector<uint8_t> bytes;
+    };
+
+    void forEachChunk(size_t count, const std::function<void(size_t)>& fn) const;
+    void encodeChunk(EncodedChunk& chunk, bool final, bool last);
+    bool writeChunk(const char type[4], const uint8_t* data, size_t size);
+    bool fail(const std::string& message);
+
+  private:
+    int m_Level{kDeflateDefaultLevel};
+    ThreadPool* m_Pool{nullptr};
+    std::ofstream m_Out;
+    std::string m_Path;
+    int m_Width{0};
+    int m_Height{0};
+    int m_RowsWritten{0};
+    uint32_t m_Adler{1};
+    std::vector<uint8_t> m_PrevRow;    // unfiltered, zero before the first row
+    std::vector<uint8_t> m_Filtered;   // deflate window, then the filtered band
+    size_t m_WindowSize{0};
+    bool m_StreamStarted{false};       // zlib header written
+    std::vector<EncodedChunk> m_Chunks;
+};
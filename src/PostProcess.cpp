@@ -0,0 +1,121 @@
+#include <PostProcess.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    // 8-bit sRGB code of linear i / (kSrgbTableSize - 1), rounded. Neighbouring
+    // entries differ by less than one code, so the table loses nothing visible.
+    struct SrgbTable {
+        uint8_t codes[kSrgbTableSize];
+
+        SrgbTable()
+        {
+            for (uint32_t i = 0; i < kSrgbTableSize; ++i) {
+                double linear = static_cast<double>(i) / (kSrgbTableSize - 1);
+                double encoded = linear <= 0.0031308 ? 12.92 * linear : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+                codes[i] = static_cast<uint8_t>(std::lround(encoded * 255.0));
+            }
+        }
+    };
+
+    const uint8_t* srgbTable()
+    {
+        static const SrgbTable table;
+        return table.codes;
+    }
+}
+
+size_t pixelSize(PixelFormat format)
+{
+    switch (format) {
+        case PixelFormat::Rgba8:
+        case PixelFormat::Bgra8:
+            return 4;
+        case PixelFormat::RgbF32:
+            return 3 * sizeof(float);
+        case PixelFormat::RgbaF32:
+            return 4 * sizeof(float);
+        default:
+            return 3;
+    }
+}
+
+bool parseToneMap(const std::string& name, ToneMap& outToneMap)
+{
+    if (name == "clamp") {
+        outToneMap = ToneMap::Clamp;
+    } else if (name == "reinhard") {
+        outToneMap = ToneMap::Reinhard;
+    } else if (name == "aces") {
+        outToneMap = ToneMap::Aces;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* toneMapName(ToneMap toneMap)
+{
+    switch (toneMap) {
+        case ToneMap::Reinhard:
+            return "reinhard";
+        case ToneMap::Aces:
+            return "aces";
+        default:
+            return "clamp";
+    }
+}
+
+void quantizePixels(const KernelTable& kernels, const PostProcess& post, const float* rgb, size_t pixelCount,
+                    unsigned char* out)
+{
+    QuantizeParams params;
+    params.exposure = post.exposure;
+    params.toneMap = post.toneMap;
+    params.srgbTable = post.srgb ? srgbTable() : nullptr;
+    kernels.quantize(rgb, pixelCount * 3, params, out);
+}
+
+void convertPixels(const KernelTable& kernels, const PostProcess& post, const float* rgb, size_t pixelCount,
+                   PixelFormat format, void* out)
+{
+    switch (format) {
+        case PixelFormat::Rgb8:
+            quantizePixels(kernels, post, rgb, pixelCount, static_cast<unsigned char*>(out));
+            return;
+        case PixelFormat::RgbF32:
+            std::memcpy(out, rgb, pixelCount * 3 * sizeof(float));
+            return;
+        case PixelFormat::RgbaF32: {
+            float* dst = static_cast<float*>(out);
+            for (size_t i = 0; i < pixelCount; ++i) {
+                dst[i * 4 + 0] = rgb[i * 3 + 0];
+                dst[i * 4 + 1] = rgb[i * 3 + 1];
+                dst[i * 4 + 2] = rgb[i * 3 + 2];
+                dst[i * 4 + 3] = 1.0f;
+            }
+            return;
+        }
+        default: {
+            // Quantized a slice at a time through a small buffer, then widened to four channels.
+            constexpr size_t kSlice = 256;
+            unsigned char slice[kSlice * 3];
+            unsigned char* dst = static_cast<unsigned char*>(out);
+            const int red = format == PixelFormat::Bgra8 ? 2 : 0;
+            for (size_t first = 0; first < pixelCount; first += kSlice) {
+                const size_t count = std::min(kSlice, pixelCount - first);
+                quantizePixels(kernels, post, rgb + first * 3, count, slice);
+                for (size_t i = 0; i < count; ++i) {
+                    unsigned char* px = dst + (first + i) * 4;
+                    px[red] = slice[i * 3 + 0];
+                    px[1] = slice[i * 3 + 1];
+                    px[2 - red] = slice[i * 3 + 2];
+                    px[3] = 255;
+                }
+            }
+            return;
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Kernels.h>
+
+#include <cstddef>
+#include <string>
+
+// How the float framebuffer becomes 8-bit pixels. The default (clamp, no
+// exposure change, linear) reproduces the classic clamp-and-truncate output.
+struct PostProcess {
+    ToneMap toneMap{ToneMap::Clamp};
+    float exposure{1.0f};
+    bool srgb{false};  // encode with the sRGB transfer curve (rounded) instead of storing linear values
+};
+
+// Layout of one pixel in a caller's buffer. The 8-bit formats go through the
+// post stage and get an opaque alpha; the float formats keep the unclamped
+// linear radiance (alpha 1).
+enum class PixelFormat {
+    Rgb8,
+    Rgba8,
+    Bgra8,
+    RgbF32,
+    RgbaF32
+};
+
+size_t pixelSize(PixelFormat format);
+
+bool parseToneMap(const std::string& name, ToneMap& outToneMap);
+const char* toneMapName(ToneMap toneMap);
+
+// Tone-maps and quantizes pixelCount RGB pixels with the quantize kernel of kernels.
+void quantizePixels(const KernelTable& kernels, const PostProcess& post, const float* rgb, size_t pixelCount,
+                    unsigned char* out);
+// Stores pixelCount RGB float pixels into out as format, tightly packed.
+void convertPixels(const KernelTable& kernels, const PostProcess& post, const float* rgb, size_t pixelCount,
+                   PixelFormat format, void* out);
@@ -1,53 +1,30 @@
 #include <RayTracer.h>
-#include <stb/stb_image_write.h>
+#include <Checkpoint.h>
+#include <Hash.h>
+#include <MappedFile.h>
+#include <PngWriter.h>
+#include <SceneFile.h>
+#include <SceneParser.h>
+#include <ThreadPool.h>
 #include <algorithm>
+#include <chrono>
 #include <cmath>
-#include <fstream>
+#include <cstdio>
+#include <future>
 #include <iostream>
 #include <limits>
-#include <sstream>
+#include <mutex>
+#include <numeric>
+#include <utility>
 
-namespace {
-    constexpr float kAirRefractiveIndex = 1.0f;
-    constexpr float kGlassRefractiveIndex = 1.5f;
-    constexpr float kMaxDistance = std::numeric_limits<float>::infinity();
-
-    glm::vec3 clampColor(const glm::vec3& c)
-    {
-        return glm::clamp(c, glm::vec3(0.0f), glm::vec3(1.0f));
-    }
-}
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "the framebuffer is read as packed RGB floats");
 
 Sphere::Sphere(const glm::vec3& c, float r, const Material& mat)
     : Object(mat), m_Center(c), m_Radius(r) {}
 
-bool Sphere::intersect(const Ray& ray, float tMin, float tMax, HitInfo& outHit) const
+void Sphere::flatten(SceneGeometry& geometry, uint32_t order) const
 {
-    glm::vec3 oc = ray.origin - m_Center;
-    float a = glm::dot(ray.direction, ray.direction);
-    float b = 2.0f * glm::dot(oc, ray.direction);
-    float c = glm::dot(oc, oc) - m_Radius * m_Radius;
-    float discriminant = b * b - 4.0f * a * c;
-    if (discriminant < 0.0f) {
-        return false;
-    }
-
-    float sqrtD = std::sqrt(discriminant);
-    float t = (-b - sqrtD) / (2.0f * a);
-    if (t < tMin || t > tMax) {
-        t = (-b + sqrtD) / (2.0f * a);
-        if (t < tMin || t > tMax) {
-            return false;
-        }
-    }
-
-    outHit.t = t;
-    outHit.point = ray.origin + t * ray.direction;
-    outHit.normal = glm::normalize(outHit.point - m_Center);
-    outHit.material = m_Material;
-    outHit.object = this;
-    outHit.hit = true;
-    return true;
+    geometry.addSphere(m_Center, m_Radius, m_Material, order);
 }
 
 Plane::Plane(const glm::vec3& normal, float d, const Material& mat)
@@ -63,348 +40,877 @@ Plane::Plane(const glm::vec3& normal, float d, const Material& mat)
     }
 }
 
-bool Plane::intersect(const Ray& ray, float tMin, float tMax, HitInfo& outHit) const
+void Plane::flatten(SceneGeometry& geometry, uint32_t order) const
 {
-    float denom = glm::dot(m_Normal, ray.direction);
-    if (std::abs(denom) < 1e-6f) {
-        return false;  // Parallel
-    }
+    geometry.addPlane(m_Normal, m_D, m_Material, order);
+}
 
-    float t = -(glm::dot(m_Normal, ray.origin) + m_D) / denom;
-    if (t < tMin || t > tMax) {
+RayTracer::RayTracer(int width, int height)
+    : m_Kernels(&activeKernels()), m_Width(width), m_Height(height)
+{}
+
+RayTracer::~RayTracer() = default;
+
+bool RayTracer::loadScene(const std::string& path)
+{
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Failed to open scene file: " << path << std::endl;
         return false;
     }
+    const char* data = file.data();
+    const size_t size = file.size();
+    return loadSceneData(data, size, std::move(file), path, start);
+}
 
-    outHit.t = t;
-    outHit.point = ray.origin + t * ray.direction;
-    outHit.normal = m_Normal;
-    outHit.material = m_Material;
-    outHit.object = this;
-    outHit.hit = true;
-    return true;
+bool RayTracer::loadSceneFromMemory(const char* data, size_t size, const std::string& name)
+{
+    return loadSceneData(data, size, MappedFile(), name, std::chrono::steady_clock::now());
 }
 
-glm::vec3 Plane::colorAt(const glm::vec3& point) const
+bool RayTracer::loadSceneData(const char* data, size_t size, MappedFile file, const std::string& name,
+                              std::chrono::steady_clock::time_point start)
 {
-    // Checkerboard pattern projected on the XY plane
-    glm::vec3 rgbColor = m_Material.diffuse;
-    float scaleParameter = 0.5f;
-    float checkerboard = 0.0f;
-    if (point.x < 0.0f) {
-        checkerboard += std::floor((0.5f - point.x) / scaleParameter);
-    } else {
-        checkerboard += std::floor(point.x / scaleParameter);
+    m_Scene = Scene{};
+    m_LoadStats = LoadStats{};
+    m_LoadStats.bytes = size;
+    m_LoadStats.binary = isSceneFile(data, size);
+    if (m_LoadStats.binary) {
+        // Already compiled: render straight from the mapping (or a copy of the caller's bytes).
+        if (file.data() != data) {
+            file.assign(data, size);
+        }
+        file.advise(MappedFile::Access::Random);
+        m_Compiled = CompiledScene::loadBinary(std::move(file), name);
+        m_LoadStats.parseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return m_Compiled != nullptr;
     }
 
-    if (point.y < 0.0f) {
-        checkerboard += std::floor((0.5f - point.y) / scaleParameter);
-    } else {
-        checkerboard += std::floor(point.y / scaleParameter);
+    const uint64_t cacheKey = m_DiskCache ? SceneDiskCache::key(data, size) : 0;
+    if (m_DiskCache) {
+        m_Compiled = m_DiskCache->load(cacheKey, name);
+        if (m_Compiled) {
+            m_LoadStats.cacheHit = true;
+            m_LoadStats.parseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return true;
+        }
+    }
+
+    if (!parseSceneText(data, size, name, m_Scene)) {
+        return false;
     }
+    const auto parsed = std::chrono::steady_clock::now();
+    m_LoadStats.parseSeconds = std::chrono::duration<double>(parsed - start).count();
 
-    checkerboard = (checkerboard * 0.5f) - int(checkerboard * 0.5f);
-    checkerboard *= 2.0f;
-    if (checkerboard > 0.5f) {
-        return 0.5f * rgbColor;
+    compileScene();
+    m_LoadStats.compileSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parsed).count();
+    if (m_DiskCache) {
+        m_DiskCache->store(cacheKey, *m_Compiled);
     }
-    return rgbColor;
+    return true;
 }
 
-RayTracer::RayTracer(int width, int height)
-    : m_Width(width), m_Height(height)
-{}
+void RayTracer::setScene(Scene scene)
+{
+    m_Scene = std::move(scene);
+    m_LoadStats = LoadStats{};
+    compileScene();
+}
 
-bool RayTracer::loadScene(const std::string& path)
+void RayTracer::setCompiledScene(std::shared_ptr<const CompiledScene> scene)
 {
-    std::ifstream in(path);
-    if (!in.is_open()) {
-        std::cerr << "Failed to open scene file: " << path << std::endl;
+    m_Scene = Scene{};
+    m_LoadStats = LoadStats{};
+    m_Compiled = std::move(scene);
+}
+
+void RayTracer::compileScene()
+{
+    m_Compiled = CompiledScene::compile(m_Scene);
+}
+
+bool RayTracer::closestHit(const Ray& ray, float tMin, float tMax, HitInfo& outHit) const
+{
+    ScalarHit hit;
+    if (!m_Kernels->closestHit(m_Compiled->geometryView(), &ray.origin.x, &ray.direction.x, tMin, tMax, hit)) {
         return false;
     }
+    fillHit(ray, {static_cast<PrimitiveKind>(hit.kind), hit.index}, hit.t, outHit);
+    return true;
+}
 
-    m_Scene = Scene{};
+void RayTracer::fillHit(const Ray& ray, PrimitiveRef prim, float t, HitInfo& outHit) const
+{
+    // Hit attributes are only evaluated for the winner.
+    const GeometryView& geo = m_Compiled->geometryView();
+    outHit.t = t;
+    outHit.point = ray.origin + t * ray.direction;
+    if (prim.kind == PrimitiveKind::Sphere) {
+        outHit.normal = glm::normalize(outHit.point - geo.sphereCenter(prim.index));
+    } else {
+        outHit.normal = geo.planeNormal(prim.index);
+    }
+    outHit.prim = prim;
+    outHit.material = geo.materialIndex(prim);
+}
 
-    struct PendingLight {
-        Light light;
-        bool hasPosition{false};
-        bool hasIntensity{false};
-    };
-    std::vector<PendingLight> pendingLights;
-    std::vector<Object*> objectOrder;
-
-    std::string tag;
-    while (in >> tag) {
-        if (tag == "e") {
-            in >> m_Scene.camera.eye.x >> m_Scene.camera.eye.y >> m_Scene.camera.eye.z >> m_Scene.camera.screenDistance;
-        } else if (tag == "u") {
-            in >> m_Scene.camera.up.x >> m_Scene.camera.up.y >> m_Scene.camera.up.z >> m_Scene.camera.screenHeight;
-        } else if (tag == "f") {
-            in >> m_Scene.camera.forward.x >> m_Scene.camera.forward.y >> m_Scene.camera.forward.z >> m_Scene.camera.screenWidth;
-        } else if (tag == "a") {
-            in >> m_Scene.ambient.r >> m_Scene.ambient.g >> m_Scene.ambient.b;
-            float ignore;
-            in >> ignore;
-        } else if (tag == "d") {
-            Light l{};
-            in >> l.direction.x >> l.direction.y >> l.direction.z;
-            float typeFlag;
-            in >> typeFlag;
-            l.direction = glm::normalize(l.direction);
-            l.isSpot = typeFlag > 0.5f;
-            l.cutoff = 0.0f;
-            pendingLights.push_back({l, false, false});
-        } else if (tag == "p") {
-            glm::vec3 pos;
-            float cutoff = 0.0f;
-            in >> pos.x >> pos.y >> pos.z >> cutoff;
-            for (auto& pl : pendingLights) {
-                if (pl.light.isSpot && !pl.hasPosition) {
-                    pl.light.position = pos;
-                    pl.light.cutoff = cutoff;
-                    pl.hasPosition = true;
-                    break;
-                }
-            }
-        } else if (tag == "i") {
-            glm::vec3 intensity;
-            float ignore = 0.0f;
-            in >> intensity.r >> intensity.g >> intensity.b >> ignore;
-            for (auto& pl : pendingLights) {
-                if (!pl.hasIntensity) {
-                    pl.light.intensity = intensity;
-                    pl.hasIntensity = true;
-                    break;
-                }
-            }
-        } else if (tag == "o" || tag == "r" || tag == "t") {
-            float a, b, c, d;
-            in >> a >> b >> c >> d;
-            ObjectType type = ObjectType::Opaque;
-            if (tag == "r") {
-                type = ObjectType::Reflective;
-            } else if (tag == "t") {
-                type = ObjectType::Transparent;
-            }
-            Material mat{};
-            mat.type = type;
-            // Reflective and transparent objects ignore ambient/diffuse
-            bool isSphere = d > 0.0f;
-            if (isSphere) {
-                m_Scene.objects.push_back(std::make_unique<Sphere>(glm::vec3(a, b, c), d, mat));
-            } else {
-                m_Scene.objects.push_back(std::make_unique<Plane>(glm::vec3(a, b, c), d, mat));
-            }
-            objectOrder.push_back(m_Scene.objects.back().get());
-        } else if (tag == "c") {
-            glm::vec3 color;
-            float shininess = 1.0f;
-            in >> color.r >> color.g >> color.b >> shininess;
-            if (!objectOrder.empty()) {
-                Object* obj = objectOrder.front();
-                objectOrder.erase(objectOrder.begin());
-                Material mat = obj->material();
-                mat.ambient = color;
-                mat.diffuse = color;
-                mat.shininess = shininess;
-                obj->setMaterial(mat);
-            }
-        } else {
-            std::string line;
-            std::getline(in, line); // skip unknown tag
-        }
+glm::vec3 RayTracer::shade(const HitInfo& hit, const Ray& ray, OccluderCache& cache) const
+{
+    const Material& mat = m_Compiled->material(hit.material);
+    glm::vec3 normal = hit.normal;
+    if (glm::dot(ray.direction, normal) > 0.0f) {
+        normal = -normal;
     }
 
-    // Finalize lights (fill defaults if needed)
-    m_Scene.lights.clear();
-    for (auto& pl : pendingLights) {
-        m_Scene.lights.push_back(pl.light);
+    glm::vec3 baseColor = hit.prim.kind == PrimitiveKind::Plane ? checkerboardColor(mat.diffuse, hit.point) : mat.diffuse;
+    glm::vec3 result = mat.ambient * m_Compiled->ambient();
+
+    glm::vec3 viewDir = glm::normalize(m_Camera.eye - hit.point);
+
+    PhongInput in;
+    for (int c = 0; c < 3; ++c) {
+        in.point[c] = hit.point[c];
+        in.normal[c] = normal[c];
+        in.viewDir[c] = viewDir[c];
+        in.baseColor[c] = baseColor[c];
+        in.specular[c] = mat.specular[c];
     }
-    return true;
+    in.shininess = mat.shininess;
+    in.epsilon = m_Epsilon;
+    in.ignoreKind = static_cast<uint32_t>(hit.prim.kind);
+    in.ignoreIndex = hit.prim.index;
+    m_Kernels->phong(m_Compiled->geometryView(), m_Compiled->lightView(), in, &cache, &result.x);
+
+    return result;  // unclamped HDR; clamping is up to the post stage
 }
 
-bool RayTracer::closestHit(const Ray& ray, float tMin, float tMax, HitInfo& outHit) const
+glm::vec3 RayTracer::trace(const Ray& ray, int depth, OccluderCache& cache) const
 {
-    HitInfo closest{};
-    closest.t = tMax;
-    bool hitSomething = false;
+    if (depth > m_MaxDepth) {
+        return glm::vec3(0.0f);
+    }
+
+    HitInfo hit{};
+    if (!closestHit(ray, m_Epsilon, kMaxDistance, hit)) {
+        return glm::vec3(0.0f);  // background
+    }
+    return traceHit(hit, ray, depth, cache);
+}
+
+glm::vec3 RayTracer::traceHit(HitInfo& hit, const Ray& firstRay, int depth, OccluderCache& cache) const
+{
+    // Mirrors and glass pass the color of their single continuation ray back
+    // unchanged, so the whole path state is the current ray and its depth: each
+    // bounce overwrites it in place instead of recursing.
+    Ray ray = firstRay;
+    while (true) {
+        switch (m_Compiled->material(hit.material).type) {
+            case ObjectType::Reflective:
+                ray = reflectedRay(ray, hit.point, hit.normal, m_Epsilon);
+                break;
+            case ObjectType::Transparent:
+                ray = refractedRay(m_Compiled->geometryView(), hit.prim, ray, hit.point, hit.normal, m_Epsilon);
+                break;
+            case ObjectType::Opaque:
+            default:
+                return shade(hit, ray, cache);
+        }
 
-    for (const auto& obj : m_Scene.objects) {
-        HitInfo temp{};
-        if (obj->intersect(ray, tMin, closest.t, temp)) {
-            hitSomething = true;
-            closest = temp;
+        if (++depth > m_MaxDepth || !closestHit(ray, m_Epsilon, kMaxDistance, hit)) {
+            return glm::vec3(0.0f);
         }
     }
+}
 
-    if (hitSomething) {
-        outHit = closest;
+PixelRect RayTracer::traceRect() const
+{
+    if (m_Crop.empty()) {
+        return {0, 0, m_Width, m_Height};
     }
-    return hitSomething;
+    return {std::max(m_Crop.x0, 0), std::max(m_Crop.y0, 0), std::min(m_Crop.x1, m_Width),
+            std::min(m_Crop.y1, m_Height)};
+}
+
+PixelRect RayTracer::outputRect() const
+{
+    return m_CropKeepsFrame ? PixelRect{0, 0, m_Width, m_Height} : traceRect();
 }
 
-bool RayTracer::isShadowed(const glm::vec3& origin, const glm::vec3& dir, float maxDist, const Object* ignore) const
+std::vector<Tile> RayTracer::makeTiles(int y0, int y1) const
 {
-    Ray shadowRay{origin + dir * m_Epsilon, dir};
-    for (const auto& obj : m_Scene.objects) {
-        if (obj.get() == ignore) {
+    // Tiles start at the window corner, so a crop is tiled like a frame of its own size.
+    const PixelRect traced = traceRect();
+    y0 = std::max(y0, traced.y0);
+    y1 = std::min(y1, traced.y1);
+    std::vector<Tile> tiles;
+    for (int y = y0; y < y1; y += m_TileSize) {
+        for (int x = traced.x0; x < traced.x1; x += m_TileSize) {
+            tiles.push_back({x, y, std::min(x + m_TileSize, traced.x1), std::min(y + m_TileSize, y1)});
+        }
+    }
+    return tiles;
+}
+
+void RayTracer::tracePacket(const Ray* rays, int count, int packetWidth, OccluderCache& cache,
+                            glm::vec3* outColors) const
+{
+    RayPacket packet;
+    packet.activeMask = (1u << count) - 1u;
+    for (int lane = 0; lane < packetWidth; ++lane) {
+        // Idle lanes replay lane 0 so they never feed garbage to the math.
+        const Ray& ray = rays[lane < count ? lane : 0];
+        packet.originX[lane] = ray.origin.x;
+        packet.originY[lane] = ray.origin.y;
+        packet.originZ[lane] = ray.origin.z;
+        packet.dirX[lane] = ray.direction.x;
+        packet.dirY[lane] = ray.direction.y;
+        packet.dirZ[lane] = ray.direction.z;
+    }
+
+    PacketHits hits;
+    if (packetWidth == 8) {
+        m_Kernels->closestHitPacket8(m_Compiled->geometryView(), packet, m_Epsilon, kMaxDistance, hits);
+    } else {
+        m_Kernels->closestHitPacket4(m_Compiled->geometryView(), packet, m_Epsilon, kMaxDistance, hits);
+    }
+
+    for (int lane = 0; lane < count; ++lane) {
+        if (hits.order[lane] < 0) {
+            outColors[lane] = glm::vec3(0.0f);  // background
             continue;
         }
         HitInfo hit{};
-        if (obj->intersect(shadowRay, m_Epsilon, maxDist, hit)) {
-            return true;
+        fillHit(rays[lane], {static_cast<PrimitiveKind>(hits.kind[lane]), hits.index[lane]}, hits.t[lane], hit);
+        outColors[lane] = traceHit(hit, rays[lane], 0, cache);
+    }
+}
+
+void RayTracer::renderTile(const Tile& tile, int packetWidth, OccluderCache& cache, const FrameTarget& target) const
+{
+    const CompiledCamera& camera = m_Camera;
+    Ray rays[kMaxPacketWidth];
+    glm::vec3 colors[kMaxPacketWidth];
+
+    for (int y = tile.y0; y < tile.y1; ++y) {
+        for (int x = tile.x0; x < tile.x1; x += packetWidth) {
+            int count = std::min(packetWidth, tile.x1 - x);
+            for (int lane = 0; lane < count; ++lane) {
+                rays[lane] = camera.ray(x + lane, y);
+            }
+            if (packetWidth == 1) {
+                colors[0] = trace(rays[0], 0, cache);
+            } else {
+                tracePacket(rays, count, packetWidth, cache, colors);
+            }
+
+            for (int lane = 0; lane < count; ++lane) {
+                target.at(x + lane, y) = colors[lane];
+            }
         }
     }
-    return false;
 }
 
-glm::vec3 RayTracer::shade(const HitInfo& hit, const Ray& ray, int depth) const
+void RayTracer::renderTileWavefront(const Tile& tile, int packetWidth, OccluderCache& cache,
+                                    const FrameTarget& target, WavefrontStats& stats) const
 {
-    const Material& mat = hit.material;
-    glm::vec3 normal = hit.normal;
-    if (glm::dot(ray.direction, normal) > 0.0f) {
-        normal = -normal;
+    const int tileWidth = tile.x1 - tile.x0;
+    const size_t pixelCount = static_cast<size_t>(tileWidth) * (tile.y1 - tile.y0);
+
+    const CompiledCamera& camera = m_Camera;
+    auto start = std::chrono::steady_clock::now();
+    RayQueue rays;
+    rays.reserve(pixelCount);
+    for (int y = tile.y0; y < tile.y1; ++y) {
+        for (int x = tile.x0; x < tile.x1; ++x) {
+            rays.push(camera.ray(x, y), static_cast<uint32_t>((y - tile.y0) * tileWidth + (x - tile.x0)));
+        }
     }
+    stats.add(WavefrontStage::Generate, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+              pixelCount);
 
-    glm::vec3 baseColor = hit.object ? hit.object->colorAt(hit.point) : mat.diffuse;
-    glm::vec3 result = mat.ambient * m_Scene.ambient;
+    WavefrontOptions options;
+    options.epsilon = m_Epsilon;
+    options.maxDepth = m_MaxDepth;
+    options.packetWidth = packetWidth;
+    options.eye = m_Camera.eye;
 
-    glm::vec3 viewDir = glm::normalize(m_Scene.camera.eye - hit.point);
+    std::vector<glm::vec3> colors(pixelCount, glm::vec3(0.0f));
+    WavefrontTracer(*m_Compiled, *m_Kernels, options).trace(rays, colors.data(), cache, stats);
 
-    for (const auto& light : m_Scene.lights) {
-        glm::vec3 L;
-        float maxDist = kMaxDistance;
-        if (light.isSpot) {
-            glm::vec3 toLight = light.position - hit.point;
-            maxDist = glm::length(toLight);
-            if (maxDist <= 0.0f) {
-                continue;
-            }
-            L = toLight / maxDist;
-            float spotCos = glm::dot(glm::normalize(light.direction), -L);
-            if (spotCos < light.cutoff) {
-                continue;
+    for (int y = tile.y0; y < tile.y1; ++y) {
+        for (int x = tile.x0; x < tile.x1; ++x) {
+            target.at(x, y) = colors[static_cast<size_t>(y - tile.y0) * tileWidth + (x - tile.x0)];
+        }
+    }
+}
+
+ThreadPool& RayTracer::threadPool()
+{
+    if (m_SharedPool) {
+        return *m_SharedPool;
+    }
+    unsigned wanted = m_ThreadCount > 0 ? static_cast<unsigned>(m_ThreadCount) : 0u;
+    if (!m_Pool || (wanted != 0 && m_Pool->size() != wanted)) {
+        m_Pool = std::make_shared<ThreadPool>(wanted);
+    }
+    return *m_Pool;
+}
+
+std::vector<glm::vec3> RayTracer::renderHDR()
+{
+    const PixelRect out = outputRect();
+    std::vector<glm::vec3> frame(static_cast<size_t>(out.width()) * out.height(), glm::vec3(0.0f));
+    beginRender();
+    const FrameTarget target{frame.data(), out.x0, out.y0, out.width()};
+    if (m_CheckpointPath.empty()) {
+        renderRows(out.y0, out.y1, target);
+    } else {
+        renderCheckpointed(target);
+    }
+    return frame;
+}
+
+std::vector<unsigned char> RayTracer::render()
+{
+    const std::vector<glm::vec3> frame = renderHDR();
+    std::vector<unsigned char> pixels(frame.size() * 3, 0);
+    postProcess(frame.data(), frame.size(), pixels.data());
+    return pixels;
+}
+
+DeadlineRender RayTracer::render(std::chrono::steady_clock::time_point deadline)
+{
+    constexpr int kCoarseBlock = 4;
+    // Estimated error of a coarse sample that matches its neighbours, so
+    // flat tiles still rank by size and count towards the quality.
+    constexpr double kFlatSampleError = 0.01;
+    const auto start = std::chrono::steady_clock::now();
+    const PixelRect out = outputRect();
+    const PixelRect traced = traceRect();
+    std::vector<glm::vec3> frame(static_cast<size_t>(out.width()) * out.height(), glm::vec3(0.0f));
+    const FrameTarget target{frame.data(), out.x0, out.y0, out.width()};
+    beginRender();
+    auto forEach = [&](size_t count, const std::function<void(size_t)>& fn) {
+        if (m_ThreadCount == 1) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i);
             }
         } else {
-            // Directional light direction points from light toward the scene
-            L = glm::normalize(-light.direction);
+            threadPool().parallelFor(count, fn);
         }
+    };
 
-        if (isShadowed(hit.point, L, maxDist - m_Epsilon, hit.object)) {
-            continue;
+    // Coarse pass: one sample per block, spread bilinearly over the pixels
+    // between the samples (and held past the last ones).
+    const int columns = (traced.width() + kCoarseBlock - 1) / kCoarseBlock;
+    const int rows = (traced.height() + kCoarseBlock - 1) / kCoarseBlock;
+    const std::vector<glm::vec3> samples = traceSamples(kCoarseBlock, columns, rows);
+    auto sampleAt = [&](int column, int row) -> const glm::vec3& {
+        return samples[static_cast<size_t>(row) * columns + column];
+    };
+    forEach(static_cast<size_t>(traced.height()), [&](size_t i) {
+        const int y = traced.y0 + static_cast<int>(i);
+        const float fy = static_cast<float>(y - traced.y0) / kCoarseBlock;
+        const int row0 = static_cast<int>(fy);
+        const int row1 = std::min(row0 + 1, rows - 1);
+        const float ty = fy - static_cast<float>(row0);
+        for (int x = traced.x0; x < traced.x1; ++x) {
+            const float fx = static_cast<float>(x - traced.x0) / kCoarseBlock;
+            const int column0 = static_cast<int>(fx);
+            const int column1 = std::min(column0 + 1, columns - 1);
+            const float tx = fx - static_cast<float>(column0);
+            const glm::vec3 top = glm::mix(sampleAt(column0, row0), sampleAt(column1, row0), tx);
+            const glm::vec3 bottom = glm::mix(sampleAt(column0, row1), sampleAt(column1, row1), tx);
+            target.at(x, y) = glm::mix(top, bottom, ty);
         }
+    });
+    // The output is kept up to date from here on, a tile at a time, so
+    // nothing is left to do once the deadline is reached.
+    DeadlineRender result;
+    result.pixels.assign(frame.size() * 3, 0);
+    postProcess(frame.data(), frame.size(), result.pixels.data());
+    const auto coarseEnd = std::chrono::steady_clock::now();
+
+    // A tile's estimated error is the contrast between the neighbouring
+    // samples it holds, on displayable luminance; the upsampled image is
+    // furthest off around edges and fine detail. Tiles are refined by most
+    // error per pixel first.
+    const std::vector<Tile> tiles = makeTiles(traced.y0, traced.y1);
+    auto luminance = [&](int column, int row) {
+        const glm::vec3 c = glm::clamp(sampleAt(column, row), glm::vec3(0.0f), glm::vec3(1.0f));
+        return 0.2126 * c.r + 0.7152 * c.g + 0.0722 * c.b;
+    };
+    std::vector<double> tileError(tiles.size(), 0.0);
+    double totalError = 0.0;
+    for (size_t t = 0; t < tiles.size(); ++t) {
+        const Tile& tile = tiles[t];
+        const int column0 = (tile.x0 - traced.x0) / kCoarseBlock;
+        const int column1 = (tile.x1 - 1 - traced.x0) / kCoarseBlock;
+        const int row0 = (tile.y0 - traced.y0) / kCoarseBlock;
+        const int row1 = (tile.y1 - 1 - traced.y0) / kCoarseBlock;
+        double error = 0.0;
+        for (int row = row0; row <= row1; ++row) {
+            for (int column = column0; column <= column1; ++column) {
+                const double l = luminance(column, row);
+                error += kFlatSampleError;
+                if (column + 1 < columns) {
+                    error += std::abs(l - luminance(column + 1, row));
+                }
+                if (row + 1 < rows) {
+                    error += std::abs(l - luminance(column, row + 1));
+                }
+            }
+        }
+        tileError[t] = error;
+        totalError += error;
+    }
+    std::vector<size_t> order(tiles.size());
+    std::iota(order.begin(), order.end(), size_t{0});
+    auto pixelsOf = [&](size_t t) { return static_cast<double>(tiles[t].width()) * tiles[t].height(); };
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return tileError[a] / pixelsOf(a) > tileError[b] / pixelsOf(b);
+    });
+
+    // Refinement: each thread takes the next tile in that order while the
+    // tile is expected to finish in time. The cost per pixel comes from the
+    // tiles traced so far, and before the first one from the coarse pass
+    // (one pixel's ray per sample).
+    const int packetWidth = packetWidthSupported(m_PacketWidth) ? m_PacketWidth : widestPacketWidth();
+    const size_t threads = m_ThreadCount == 1 ? 1 : threadPool().size();
+    const double coarseSeconds = std::chrono::duration<double>(coarseEnd - start).count();
+    const double coarseSecondsPerPixel =
+        coarseSeconds * static_cast<double>(threads) / static_cast<double>(samples.size());
+    std::mutex mutex;
+    double tracedSeconds = 0.0;  // thread time of the refined tiles
+    double tracedPixels = 0.0;
+    size_t next = 0;
+    bool outOfTime = false;
+    std::vector<uint8_t> refined(tiles.size(), 0);
+    std::vector<OcclusionStats> tileOcclusion(tiles.size());
+    std::vector<WavefrontStats> tileStats(m_Engine == RenderEngine::Wavefront ? tiles.size() : 0);
+    auto refine = [&](size_t) {
+        while (true) {
+            size_t t;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (outOfTime || next == order.size()) {
+                    return;
+                }
+                const double secondsPerPixel =
+                    tracedPixels > 0.0 ? tracedSeconds / tracedPixels : coarseSecondsPerPixel;
+                t = order[next];
+                const auto expectedEnd = std::chrono::steady_clock::now() +
+                                         std::chrono::duration<double>(secondsPerPixel * pixelsOf(t));
+                if (expectedEnd > deadline) {
+                    outOfTime = true;
+                    return;
+                }
+                ++next;
+            }
+            const auto tileStart = std::chrono::steady_clock::now();
+            OccluderCache cache;
+            if (m_Engine == RenderEngine::Wavefront) {
+                renderTileWavefront(tiles[t], packetWidth, cache, target, tileStats[t]);
+            } else {
+                renderTile(tiles[t], packetWidth, cache, target);
+            }
+            tileOcclusion[t] = {cache.queries, cache.hits};
+            const Tile& tile = tiles[t];
+            for (int y = tile.y0; y < tile.y1; ++y) {
+                const size_t offset = static_cast<size_t>(y - out.y0) * out.width() + (tile.x0 - out.x0);
+                quantizePixels(*m_Kernels, m_PostProcess, &target.at(tile.x0, y).x, static_cast<size_t>(tile.width()),
+                               result.pixels.data() + offset * 3);
+            }
+            refined[t] = 1;
+            std::lock_guard<std::mutex> lock(mutex);
+            tracedSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - tileStart).count();
+            tracedPixels += pixelsOf(t);
+        }
+    };
+    forEach(threads, refine);
+
+    result.tileCount = tiles.size();
+    double refinedError = 0.0;
+    for (size_t t = 0; t < tiles.size(); ++t) {
+        if (refined[t]) {
+            ++result.tilesRefined;
+            refinedError += tileError[t];
+        }
+        m_OcclusionStats.queries += tileOcclusion[t].queries;
+        m_OcclusionStats.cacheHits += tileOcclusion[t].cacheHits;
+    }
+    for (const WavefrontStats& stats : tileStats) {
+        m_WavefrontStats.merge(stats);
+    }
+    const double tracedTotal = static_cast<double>(traced.width()) * traced.height();
+    result.refinedFraction = tracedTotal > 0.0 ? static_cast<float>(tracedPixels / tracedTotal) : 1.0f;
+    result.quality = totalError > 0.0 ? static_cast<float>(refinedError / totalError) : 1.0f;
+    result.coarseSeconds = coarseSeconds;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
 
-        float diff = std::max(glm::dot(normal, L), 0.0f);
-        glm::vec3 diffuse = baseColor * light.intensity * diff;
+std::vector<glm::vec3> RayTracer::traceSamples(int block, int columns, int rows)
+{
+    const PixelRect traced = traceRect();
+    const int packetWidth = packetWidthSupported(m_PacketWidth) ? m_PacketWidth : widestPacketWidth();
+    std::vector<glm::vec3> samples(static_cast<size_t>(columns) * rows, glm::vec3(0.0f));
+    auto traceRow = [&](size_t row) {
+        OccluderCache cache;
+        Ray rays[kMaxPacketWidth];
+        const int y = traced.y0 + static_cast<int>(row) * block;
+        glm::vec3* out = &samples[row * static_cast<size_t>(columns)];
+        for (int column = 0; column < columns; column += packetWidth) {
+            const int count = std::min(packetWidth, columns - column);
+            for (int lane = 0; lane < count; ++lane) {
+                rays[lane] = m_Camera.ray(traced.x0 + (column + lane) * block, y);
+            }
+            if (packetWidth == 1) {
+                out[column] = trace(rays[0], 0, cache);
+            } else {
+                tracePacket(rays, count, packetWidth, cache, out + column);
+            }
+        }
+    };
+    if (m_ThreadCount == 1) {
+        for (int row = 0; row < rows; ++row) {
+            traceRow(static_cast<size_t>(row));
+        }
+    } else {
+        threadPool().parallelFor(static_cast<size_t>(rows), traceRow);
+    }
+    return samples;
+}
 
-        glm::vec3 reflectDir = glm::reflect(-L, normal);
-        float spec = std::pow(std::max(glm::dot(viewDir, reflectDir), 0.0f), mat.shininess);
-        glm::vec3 specular = mat.specular * light.intensity * spec;
+bool RayTracer::renderBands(int bandRows, const BandSink& sink)
+{
+    const PixelRect out = outputRect();
+    const PixelRect traced = traceRect();
+    // Pixels outside a crop window are never written, so a band that shows
+    // them is cleared first.
+    const bool clearBands = traced != out;
+    bandRows = std::max(1, std::min(bandRows, out.height()));
+    std::vector<glm::vec3> frame(static_cast<size_t>(out.width()) * bandRows, glm::vec3(0.0f));
+    std::vector<unsigned char> band(frame.size() * 3, 0);
+    beginRender();
+    for (int y0 = out.y0; y0 < out.y1; y0 += bandRows) {
+        const int y1 = std::min(y0 + bandRows, out.y1);
+        const size_t pixelCount = static_cast<size_t>(y1 - y0) * out.width();
+        if (clearBands) {
+            std::fill(frame.begin(), frame.begin() + static_cast<std::ptrdiff_t>(pixelCount), glm::vec3(0.0f));
+        }
+        renderRows(y0, y1, {frame.data(), out.x0, y0, out.width()});
+        postProcess(frame.data(), pixelCount, band.data());
+        if (!sink(y0 - out.y0, y1 - y0, band.data())) {
+            return false;
+        }
+    }
+    return true;
+}
 
-        result += diffuse + specular;
+void RayTracer::postProcess(const glm::vec3* frame, size_t pixelCount, unsigned char* pixels)
+{
+    // Pixels are independent, so chunks can go to any thread; the chunk size
+    // keeps each one well above the cost of handing it out.
+    constexpr size_t kChunkPixels = 64 * 1024;
+    const size_t chunkCount = (pixelCount + kChunkPixels - 1) / kChunkPixels;
+    auto runChunk = [&](size_t i) {
+        const size_t first = i * kChunkPixels;
+        const size_t count = std::min(kChunkPixels, pixelCount - first);
+        quantizePixels(*m_Kernels, m_PostProcess, &frame[first].x, count, pixels + first * 3);
+    };
+    if (m_ThreadCount == 1 || chunkCount < 2) {
+        for (size_t i = 0; i < chunkCount; ++i) {
+            runChunk(i);
+        }
+    } else {
+        threadPool().parallelFor(chunkCount, runChunk);
     }
+}
 
-    return clampColor(result);
+void RayTracer::beginRender()
+{
+    m_Kernels = &activeKernels();
+    if (!m_Compiled) {
+        compileScene();
+    }
+    CameraParams params = m_CameraOverride ? *m_CameraOverride : m_Compiled->cameraParams();
+    if (m_ScreenAspect > 0.0f) {
+        params.screenWidth = params.screenHeight * m_ScreenAspect;
+    }
+    m_Camera = compileCamera(params, m_Width, m_Height);
+    m_OcclusionStats = OcclusionStats{};
+    m_WavefrontStats = WavefrontStats{};
+    m_CheckpointStats = CheckpointStats{};
 }
 
-glm::vec3 RayTracer::handleTransparency(const HitInfo& hit, const Ray& ray, int depth) const
+void RayTracer::renderRows(int y0, int y1, const FrameTarget& target)
 {
-    glm::vec3 normal = hit.normal;
-    bool outside = glm::dot(ray.direction, normal) < 0.0f;
-    glm::vec3 n = outside ? normal : -normal;
-    float eta = outside ? (kAirRefractiveIndex / kGlassRefractiveIndex) : (kGlassRefractiveIndex / kAirRefractiveIndex);
+    const std::vector<Tile> tiles = makeTiles(y0, y1);
+    std::vector<size_t> indices(tiles.size());
+    std::iota(indices.begin(), indices.end(), size_t{0});
+    renderTiles(tiles, indices, target);
+}
 
-    glm::vec3 refractDir = glm::refract(glm::normalize(ray.direction), n, eta);
-    if (glm::dot(refractDir, refractDir) < 1e-6f) {
-        // Total internal reflection
-        glm::vec3 reflectDir = glm::reflect(ray.direction, n);
-        return trace({hit.point + reflectDir * m_Epsilon, glm::normalize(reflectDir)}, depth + 1);
+bool RayTracer::renderInto(const FrameBuffer& buffer, const TileCallback& onTile, const std::atomic<bool>* cancel)
+{
+    const PixelRect out = outputRect();
+    const size_t pixelBytes = pixelSize(buffer.format);
+    if (!buffer.data || buffer.width != out.width() || buffer.height != out.height() ||
+        buffer.rowStride < static_cast<size_t>(out.width()) * pixelBytes) {
+        std::cerr << "Frame buffer does not fit the " << out.width() << "x" << out.height() << " output" << std::endl;
+        return false;
     }
+    beginRender();
 
-    Ray insideRay{hit.point + refractDir * m_Epsilon, glm::normalize(refractDir)};
-
-    // Advance until exiting the sphere
-    const Sphere* sphere = dynamic_cast<const Sphere*>(hit.object);
-    HitInfo exitHit{};
-    if (sphere && sphere->intersect(insideRay, m_Epsilon, kMaxDistance, exitHit)) {
-        glm::vec3 exitNormal = exitHit.normal;
-        if (glm::dot(insideRay.direction, exitNormal) > 0.0f) {
-            exitNormal = -exitNormal;
-        }
-        glm::vec3 refractOutDir = glm::refract(insideRay.direction, exitNormal, kGlassRefractiveIndex / kAirRefractiveIndex);
-        if (glm::dot(refractOutDir, refractOutDir) < 1e-6f) {
-            refractOutDir = glm::reflect(insideRay.direction, exitNormal);
+    unsigned char* base = static_cast<unsigned char*>(buffer.data);
+    auto pixelAt = [&](int x, int y) {
+        return base + static_cast<size_t>(y - out.y0) * buffer.rowStride + static_cast<size_t>(x - out.x0) * pixelBytes;
+    };
+    // Nothing outside a crop window is traced: it gets black, as in render().
+    const PixelRect traced = traceRect();
+    if (traced != out) {
+        const std::vector<glm::vec3> black(static_cast<size_t>(out.width()), glm::vec3(0.0f));
+        for (int y = out.y0; y < out.y1; ++y) {
+            convertPixels(*m_Kernels, m_PostProcess, &black[0].x, black.size(), buffer.format, pixelAt(out.x0, y));
         }
-        Ray outRay{exitHit.point + refractOutDir * m_Epsilon, glm::normalize(refractOutDir)};
-        return trace(outRay, depth + 1);
     }
 
-    return trace(insideRay, depth + 1);
+    const std::vector<Tile> tiles = makeTiles(traced.y0, traced.y1);
+    std::vector<size_t> indices(tiles.size());
+    std::iota(indices.begin(), indices.end(), size_t{0});
+    auto store = [&](const Tile& tile, const FrameTarget& pixels) {
+        for (int y = tile.y0; y < tile.y1; ++y) {
+            convertPixels(*m_Kernels, m_PostProcess, &pixels.at(tile.x0, y).x, static_cast<size_t>(tile.width()),
+                          buffer.format, pixelAt(tile.x0, y));
+        }
+        if (onTile) {
+            onTile({tile.x0 - out.x0, tile.y0 - out.y0, tile.x1 - out.x0, tile.y1 - out.y0});
+        }
+    };
+    return renderTiles(tiles, indices, FrameTarget{}, store, cancel);
 }
 
-glm::vec3 RayTracer::trace(const Ray& ray, int depth) const
+struct RenderHandle::State {
+    std::atomic<bool> cancel{false};
+    std::atomic<uint64_t> donePixels{0};
+    uint64_t totalPixels{0};
+};
+
+float RenderHandle::progress() const
 {
-    if (depth > m_MaxDepth) {
-        return glm::vec3(0.0f);
+    if (!m_State || m_State->totalPixels == 0) {
+        return m_State ? 1.0f : 0.0f;
     }
+    return static_cast<float>(static_cast<double>(m_State->donePixels.load()) / m_State->totalPixels);
+}
 
-    HitInfo hit{};
-    if (!closestHit(ray, m_Epsilon, kMaxDistance, hit)) {
-        return glm::vec3(0.0f);  // background
+void RenderHandle::cancel()
+{
+    if (m_State) {
+        m_State->cancel.store(true);
     }
+}
 
-    switch (hit.material.type) {
-        case ObjectType::Reflective: {
-            glm::vec3 normal = hit.normal;
-            if (glm::dot(ray.direction, normal) > 0.0f) {
-                normal = -normal;
-            }
-            glm::vec3 reflectDir = glm::reflect(ray.direction, normal);
-            return trace({hit.point + reflectDir * m_Epsilon, glm::normalize(reflectDir)}, depth + 1);
+RenderHandle RayTracer::renderAsync()
+{
+    if (!m_Compiled) {
+        compileScene();
+    }
+    // Per-render state (camera, statistics) lives in the tracer, so each
+    // async render gets a tracer of its own with these settings.
+    auto tracer = std::make_unique<RayTracer>(m_Width, m_Height);
+    tracer->m_Compiled = m_Compiled;
+    tracer->m_MaxDepth = m_MaxDepth;
+    tracer->m_Epsilon = m_Epsilon;
+    tracer->m_ThreadCount = m_ThreadCount;
+    tracer->m_TileSize = m_TileSize;
+    tracer->m_PacketWidth = m_PacketWidth;
+    tracer->m_Engine = m_Engine;
+    tracer->m_PostProcess = m_PostProcess;
+    tracer->m_Crop = m_Crop;
+    tracer->m_CropKeepsFrame = m_CropKeepsFrame;
+    tracer->m_ScreenAspect = m_ScreenAspect;
+    tracer->m_CameraOverride = m_CameraOverride;
+    if (m_ThreadCount != 1) {
+        tracer->m_SharedPool = m_SharedPool;
+        if (!m_SharedPool) {
+            threadPool();
+            tracer->m_Pool = m_Pool;
         }
-        case ObjectType::Transparent:
-            return handleTransparency(hit, ray, depth);
-        case ObjectType::Opaque:
-        default:
-            return shade(hit, ray, depth);
     }
+
+    RenderHandle handle;
+    handle.m_State = std::make_shared<RenderHandle::State>();
+    const PixelRect traced = tracer->traceRect();
+    handle.m_State->totalPixels = static_cast<uint64_t>(traced.width()) * traced.height();
+    auto run = [tracer = std::move(tracer), state = handle.m_State]() {
+        RenderResult result;
+        result.width = tracer->outputWidth();
+        result.height = tracer->outputHeight();
+        std::vector<unsigned char> pixels(static_cast<size_t>(result.width) * result.height * 3, 0);
+        const FrameBuffer buffer{pixels.data(), result.width, result.height, static_cast<size_t>(result.width) * 3,
+                                 PixelFormat::Rgb8};
+        auto onTile = [&](const PixelRect& rect) {
+            state->donePixels += static_cast<uint64_t>(rect.width()) * rect.height();
+        };
+        result.cancelled = !tracer->renderInto(buffer, onTile, &state->cancel);
+        result.occlusion = tracer->occlusionStats();
+        result.wavefront = tracer->wavefrontStats();
+        if (!result.cancelled) {
+            result.pixels = std::move(pixels);
+        }
+        return result;
+    };
+    handle.m_Future = std::async(std::launch::async, std::move(run)).share();
+    return handle;
 }
 
-std::vector<unsigned char> RayTracer::render()
+void RayTracer::renderCheckpointed(const FrameTarget& target)
 {
-    std::vector<unsigned char> pixels(static_cast<size_t>(m_Width) * m_Height * 3, 0);
+    const std::vector<Tile> tiles = makeTiles(0, m_Height);
+    // The key's size is the buffer's; the frame size, windows and aspect
+    // decide which rays fill it.
+    const PixelRect traced = traceRect();
+    const PixelRect out = outputRect();
+    const int32_t view[10] = {m_Width,   m_Height, traced.x0, traced.y0, traced.x1,
+                              traced.y1, out.x0,   out.y0,    out.x1,    out.y1};
+    uint64_t fingerprint = hashBytes(view, sizeof(view), m_Compiled->fingerprint());
+    fingerprint = hashBytes(&m_ScreenAspect, sizeof(m_ScreenAspect), fingerprint);
+    if (m_CameraOverride) {
+        fingerprint = hashBytes(&*m_CameraOverride, sizeof(CameraParams), fingerprint);
+    }
+    const CheckpointKey key{fingerprint, out.width(), out.height(), m_TileSize, m_MaxDepth};
+    const uint32_t tileCount = static_cast<uint32_t>(tiles.size());
+    std::vector<uint8_t> done(tiles.size(), 0);
+    uint64_t keepBytes = 0;
+    if (m_Resume) {
+        auto restore = [&](uint32_t i, const glm::vec3* pixels, uint32_t pixelCount) {
+            const Tile& tile = tiles[i];
+            if (pixelCount != static_cast<uint32_t>(tile.width()) * static_cast<uint32_t>(tile.height())) {
+                return false;
+            }
+            for (int y = tile.y0; y < tile.y1; ++y) {
+                std::copy_n(pixels + static_cast<size_t>(y - tile.y0) * tile.width(), tile.width(),
+                            &target.at(tile.x0, y));
+            }
+            m_CheckpointStats.tilesResumed += done[i] ? 0 : 1;
+            done[i] = 1;
+            return true;
+        };
+        if (!loadCheckpoint(m_CheckpointPath, key, tileCount, restore, keepBytes)) {
+            keepBytes = 0;
+        }
+    }
+    m_CheckpointStats.tileCount = tiles.size();
 
-    glm::vec3 forward = glm::normalize(m_Scene.camera.forward);
-    glm::vec3 right = glm::normalize(glm::cross(forward, m_Scene.camera.up));
-    glm::vec3 up = glm::normalize(glm::cross(right, forward));
-    glm::vec3 screenCenter = m_Scene.camera.eye + forward * m_Scene.camera.screenDistance;
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        if (!done[i]) {
+            pending.push_back(i);
+        }
+    }
 
-    for (int y = 0; y < m_Height; ++y) {
-        for (int x = 0; x < m_Width; ++x) {
-            float px = ((static_cast<float>(x) + 0.5f) / static_cast<float>(m_Width) - 0.5f) * m_Scene.camera.screenWidth;
-            float py = (0.5f - (static_cast<float>(y) + 0.5f) / static_cast<float>(m_Height)) * m_Scene.camera.screenHeight;
+    // Each tile is appended to the checkpoint by the thread that finished it,
+    // so saving never holds up the other threads.
+    CheckpointWriter writer;
+    const bool saving = writer.open(m_CheckpointPath, key, tileCount, keepBytes, m_CheckpointInterval);
+    auto save = [&](const Tile& tile, const FrameTarget& pixels) {
+        if (saving) {
+            // renderTiles hands back the element of tiles, so its index is its offset.
+            const size_t i = static_cast<size_t>(&tile - tiles.data());
+            writer.append(static_cast<uint32_t>(i), &pixels.at(tile.x0, tile.y0), tile.width(), tile.height(),
+                          static_cast<size_t>(pixels.stride));
+        }
+    };
+    renderTiles(tiles, pending, target, save);
+    writer.close();
+    m_CheckpointStats.tilesSaved = writer.tilesWritten();
+    std::remove(m_CheckpointPath.c_str());  // the frame is complete
+}
 
-            glm::vec3 pixelPos = screenCenter + right * px + up * py;
-            glm::vec3 dir = glm::normalize(pixelPos - m_Scene.camera.eye);
-            glm::vec3 color = trace({m_Scene.camera.eye, dir}, 0);
-            color = clampColor(color);
+bool RayTracer::renderTiles(const std::vector<Tile>& tiles, const std::vector<size_t>& indices,
+                            const FrameTarget& target, const TileFinished& finished, const std::atomic<bool>* cancel)
+{
+    const int packetWidth = packetWidthSupported(m_PacketWidth) ? m_PacketWidth : widestPacketWidth();
+
+    // Per-tile counters and stage timings, merged once all tiles are done.
+    std::vector<OcclusionStats> tileOcclusion(indices.size());
+    std::vector<WavefrontStats> tileStats(m_Engine == RenderEngine::Wavefront ? indices.size() : 0);
+    std::atomic<size_t> tilesDone{0};
+    auto runTile = [&](size_t i) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            return;
+        }
+        // A fresh last-occluder cache per tile: it stays on one thread and
+        // never carries primitive indices over from an earlier scene.
+        OccluderCache cache;
+        const Tile& tile = tiles[indices[i]];
+        std::vector<glm::vec3> scratch;
+        FrameTarget tileTarget = target;
+        if (!target.pixels) {
+            scratch.assign(static_cast<size_t>(tile.width()) * tile.height(), glm::vec3(0.0f));
+            tileTarget = {scratch.data(), tile.x0, tile.y0, tile.width()};
+        }
+        if (m_Engine == RenderEngine::Wavefront) {
+            renderTileWavefront(tile, packetWidth, cache, tileTarget, tileStats[i]);
+        } else {
+            renderTile(tile, packetWidth, cache, tileTarget);
+        }
+        tileOcclusion[i] = {cache.queries, cache.hits};
+        if (finished) {
+            finished(tile, tileTarget);
+        }
+        ++tilesDone;
+    };
 
-            size_t idx = (static_cast<size_t>(y) * m_Width + x) * 3;
-            pixels[idx + 0] = static_cast<unsigned char>(color.r * 255.0f);
-            pixels[idx + 1] = static_cast<unsigned char>(color.g * 255.0f);
-            pixels[idx + 2] = static_cast<unsigned char>(color.b * 255.0f);
+    // Every pixel only depends on its own camera ray, so tiles can be traced
+    // in any order on any thread and still give the serial result bit for bit.
+    if (m_ThreadCount == 1) {
+        for (size_t i = 0; i < indices.size(); ++i) {
+            runTile(i);
         }
+    } else {
+        threadPool().parallelFor(indices.size(), runTile, cancel);
     }
 
-    return pixels;
+    for (const OcclusionStats& stats : tileOcclusion) {
+        m_OcclusionStats.queries += stats.queries;
+        m_OcclusionStats.cacheHits += stats.cacheHits;
+    }
+    for (const WavefrontStats& stats : tileStats) {
+        m_WavefrontStats.merge(stats);
+    }
+    return tilesDone.load() == indices.size();
 }
 
-bool RayTracer::writePNG(const std::string& path, const std::vector<unsigned char>& pixels) const
+std::unique_ptr<ImageStreamWriter> RayTracer::makeWriter(ImageFormat format)
 {
-    int stride = m_Width * 3;
-    int success = stbi_write_png(path.c_str(), m_Width, m_Height, 3, pixels.data(), stride);
-    if (!success) {
-        std::cerr << "Failed to write image: " << path << std::endl;
+    if (format != ImageFormat::Png) {
+        return makeImageWriter(format);
+    }
+    auto writer = std::make_unique<PngStreamWriter>();
+    writer->setLevel(m_PngLevel);
+    writer->setThreadPool(m_ThreadCount == 1 ? nullptr : &threadPool());
+    return writer;
+}
+
+bool RayTracer::writeImage(const std::string& path, ImageFormat format, const std::vector<unsigned char>& pixels)
+{
+    std::unique_ptr<ImageStreamWriter> writer = makeWriter(format);
+    return writer->open(path, outputWidth(), outputHeight()) && writer->writeRows(pixels.data(), outputHeight()) &&
+           writer->close();
+}
+
+bool RayTracer::renderImage(const std::string& path, ImageFormat format, int bandRows)
+{
+    std::unique_ptr<ImageStreamWriter> writer = makeWriter(format);
+    if (!writer->open(path, outputWidth(), outputHeight())) {
         return false;
     }
-    return true;
+    bool rendered = renderBands(bandRows, [&](int, int rowCount, const unsigned char* pixels) {
+        return writer->writeRows(pixels, rowCount);
+    });
+    return rendered && writer->close();
 }
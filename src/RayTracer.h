@@ -1,38 +1,33 @@
 #pragma once
 
+#include <CompiledScene.h>
+#include <MappedFile.h>
+#include <Deflate.h>
+#include <Geometry.h>
+#include <ImageWriter.h>
+#include <Kernels.h>
+#include <PostProcess.h>
+#include <SceneDiskCache.h>
+#include <Wavefront.h>
 #include <glm/glm.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
 #include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
-struct Ray {
-    glm::vec3 origin;
-    glm::vec3 direction;
-};
-
-enum class ObjectType {
-    Opaque,
-    Reflective,
-    Transparent
-};
-
-struct Material {
-    glm::vec3 ambient{0.0f};
-    glm::vec3 diffuse{0.0f};
-    glm::vec3 specular{0.7f, 0.7f, 0.7f};
-    float shininess{1.0f};
-    ObjectType type{ObjectType::Opaque};
-};
-
+// Closest hit of a ray. The kernels only produce t and prim; point, normal and
+// material are evaluated once, for the winning primitive.
 struct HitInfo {
     float t{0.0f};
+    PrimitiveRef prim{};
     glm::vec3 point{0.0f};
     glm::vec3 normal{0.0f};
-    const class Object* object{nullptr};
-    Material material{};
-    bool hit{false};
+    uint32_t material{0};  // index into SceneGeometry::materials
 };
 
 class Object {
@@ -43,8 +38,8 @@ class Object {
     const Material& material() const { return m_Material; }
     void setMaterial(const Material& mat) { m_Material = mat; }
 
-    virtual bool intersect(const Ray& ray, float tMin, float tMax, HitInfo& outHit) const = 0;
-    virtual glm::vec3 colorAt(const glm::vec3& point) const { return m_Material.diffuse; }
+    // Appends the render-time (structure-of-arrays) form of this object.
+    virtual void flatten(SceneGeometry& geometry, uint32_t order) const = 0;
 
   protected:
     Material m_Material;
@@ -53,7 +48,7 @@ class Object {
 class Sphere : public Object {
   public:
     Sphere(const glm::vec3& c, float r, const Material& mat);
-    bool intersect(const Ray& ray, float tMin, float tMax, HitInfo& outHit) const override;
+    void flatten(SceneGeometry& geometry, uint32_t order) const override;
 
   private:
     glm::vec3 m_Center;
@@ -63,8 +58,7 @@ class Sphere : public Object {
 class Plane : public Object {
   public:
     Plane(const glm::vec3& normal, float d, const Material& mat);
-    bool intersect(const Ray& ray, float tMin, float tMax, HitInfo& outHit) const override;
-    glm::vec3 colorAt(const glm::vec3& point) const override;
+    void flatten(SceneGeometry& geometry, uint32_t order) const override;
 
   private:
     glm::vec3 m_Normal;
@@ -79,41 +73,322 @@ struct Light {
     float cutoff{0.0f};         // cosine of cutoff angle for spotlights
 };
 
-struct CameraParams {
-    glm::vec3 eye{0.0f};
-    glm::vec3 up{0.0f, 1.0f, 0.0f};
-    glm::vec3 forward{0.0f, 0.0f, -1.0f};
-    float screenDistance{1.0f};
-    float screenWidth{2.0f};
-    float screenHeight{2.0f};
+// Pixel rectangle [x0, x1) x [y0, y1) of the frame.
+struct PixelRect {
+    int x0{0};
+    int y0{0};
+    int x1{0};  // exclusive
+    int y1{0};  // exclusive
+
+    int width() const { return x1 - x0; }
+    int height() const { return y1 - y0; }
+    bool empty() const { return x1 <= x0 || y1 <= y0; }
+    bool operator==(const PixelRect& other) const
+    {
+        return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1;
+    }
+    bool operator!=(const PixelRect& other) const { return !(*this == other); }
+};
+
+using Tile = PixelRect;
+
+// Float pixels being rendered into: frame pixel (x, y) is stored at
+// pixels[(y - originY) * stride + (x - originX)], so a buffer can hold any
+// window of the frame.
+struct FrameTarget {
+    glm::vec3* pixels{nullptr};
+    int originX{0};
+    int originY{0};
+    int stride{0};  // pixels per row
+
+    glm::vec3& at(int x, int y) const { return pixels[static_cast<size_t>(y - originY) * stride + (x - originX)]; }
 };
 
 struct Scene {
     CameraParams camera{};
     glm::vec3 ambient{0.0f};
     std::vector<Light> lights;
-    std::vector<std::unique_ptr<Object>> objects;
+    std::vector<std::unique_ptr<Object>> objects;  // authoring form, as parsed
+};
+
+enum class RenderEngine {
+    Recursive,  // one path per camera ray, depth-first through trace()
+    Wavefront   // per tile, all paths advanced a bounce at a time in ray queues
+};
+
+struct LoadStats {
+    size_t bytes{0};
+    double parseSeconds{0.0};    // reading and parsing the file, without compileScene
+    double compileSeconds{0.0};  // compileScene, BVH build included
+    bool binary{false};          // compiled scene file: parseSeconds is the whole load
+    bool cacheHit{false};        // mapped from the disk cache: parseSeconds is the whole load
+};
+
+struct CheckpointStats {
+    size_t tileCount{0};
+    size_t tilesResumed{0};      // taken from the checkpoint instead of traced
+    size_t tilesSaved{0};        // appended to the checkpoint by this render
+};
+
+struct OcclusionStats {
+    uint64_t queries{0};
+    uint64_t cacheHits{0};
+};
+
+class ThreadPool;
+
+// Receives one finished band of rendered rows: rowCount tightly packed RGB
+// rows starting at output row firstRow (row 0 is the top of the crop window
+// when only the window is output). The buffer is reused for the next band
+// as soon as the call returns; returning false stops the render.
+using BandSink = std::function<bool(int firstRow, int rowCount, const unsigned char* pixels)>;
+
+// Caller-owned pixels: height rows of width pixels in format, rowStride bytes apart.
+struct FrameBuffer {
+    void* data{nullptr};
+    int width{0};
+    int height{0};
+    size_t rowStride{0};
+    PixelFormat format{PixelFormat::Rgb8};
+};
+
+// Told about every finished tile of renderInto: rect, in frame buffer
+// coordinates, is final in the buffer.
+using TileCallback = std::function<void(const PixelRect& rect)>;
+
+// What a render started by renderAsync delivers.
+struct RenderResult {
+    std::vector<unsigned char> pixels;  // as render() returns them; empty when cancelled
+    int width{0};
+    int height{0};
+    bool cancelled{false};
+    // Of the tiles traced: the tracer's own occlusionStats and wavefrontStats
+    // only cover its synchronous renders.
+    OcclusionStats occlusion{};
+    WavefrontStats wavefront{};
+};
+
+// What render(deadline) delivers: the best image finished in time.
+struct DeadlineRender {
+    std::vector<unsigned char> pixels;  // as render() returns them
+    size_t tileCount{0};
+    size_t tilesRefined{0};             // traced at full resolution; the rest are upsampled from the coarse pass
+    float refinedFraction{0.0f};        // of the traced pixels
+    // Estimated quality, 0 to 1 (1 = the image render() gives): the share of
+    // the coarse pass's estimated error that refining has removed.
+    float quality{0.0f};
+    double coarseSeconds{0.0};
+    double seconds{0.0};
+};
+
+// A render running in the background (RayTracer::renderAsync). Copies of a
+// handle refer to the same render. Once the last copy is gone, destroying it
+// waits for the render to end, so cancel() first to make that quick.
+class RenderHandle {
+  public:
+    RenderHandle() = default;
+
+    bool valid() const { return m_State != nullptr; }
+    const std::shared_future<RenderResult>& future() const { return m_Future; }
+    // Fraction of the traced pixels that are finished, 0 to 1.
+    float progress() const;
+    // Tiles that have not started are skipped and the render ends as soon as
+    // the ones being traced are done; the result is then marked cancelled.
+    void cancel();
+
+  private:
+    friend class RayTracer;
+    struct State;
+
+    std::shared_ptr<State> m_State;
+    std::shared_future<RenderResult> m_Future;
 };
 
 class RayTracer {
   public:
     RayTracer(int width, int height);
+    ~RayTracer();
 
+    // Parses the scene file and compiles it (compileScene) for rendering.
+    // With a disk cache, scene text is looked up there first and stored
+    // there after compiling.
     bool loadScene(const std::string& path);
+    // The same for scene text or a binary scene file held in memory. Text is
+    // parsed in place; a binary scene is copied, since the compiled scene
+    // keeps pointing into it. name is used in messages.
+    bool loadSceneFromMemory(const char* data, size_t size, const std::string& name = "<memory>");
+    // Takes a scene built in code and compiles it.
+    void setScene(Scene scene);
+    // Compiled scenes for loadScene and loadSceneFromMemory; nullptr turns it off.
+    void setSceneDiskCache(std::shared_ptr<SceneDiskCache> cache) { m_DiskCache = std::move(cache); }
+    // Renders a scene compiled elsewhere, such as one held by a SceneCache.
+    // Compiled scenes are immutable, so any number of tracers may share one.
+    void setCompiledScene(std::shared_ptr<const CompiledScene> scene);
+    const std::shared_ptr<const CompiledScene>& compiledScene() const { return m_Compiled; }
+    // Rebuilds the render-ready CompiledScene from the parsed scene and the
+    // current resolution. The renderer reads only the compiled form.
+    void compileScene();
+    // Linear, unclamped radiance per pixel, row-major from the top row.
+    std::vector<glm::vec3> renderHDR();
+    // renderHDR followed by the post stage (tone map and quantize to 8 bits).
     std::vector<unsigned char> render();
-    bool writePNG(const std::string& path, const std::vector<unsigned char>& pixels) const;
+    // render() within a wall-clock budget. A coarse pass first traces one
+    // ray per 4x4 block and upsamples it to the full frame; the tiles are
+    // then traced at full resolution, those where the coarse pass looks
+    // worst first, for as long as the next tile is expected to finish by
+    // deadline. The coarse pass is always completed, even past the deadline.
+    DeadlineRender render(std::chrono::steady_clock::time_point deadline);
+    // Renders bandRows rows at a time and hands each band to sink, so only
+    // one band of pixels is ever held. Returns false if the sink failed.
+    bool renderBands(int bandRows, const BandSink& sink);
+    // Encodes a rendered frame. PNG deflates in parallel on the render threads.
+    bool writeImage(const std::string& path, ImageFormat format, const std::vector<unsigned char>& pixels);
+    bool writePNG(const std::string& path, const std::vector<unsigned char>& pixels)
+    {
+        return writeImage(path, ImageFormat::Png, pixels);
+    }
+    // Renders into a caller-owned buffer of outputWidth() x outputHeight()
+    // pixels, with no frame-sized buffer of its own. Each tile is converted
+    // into the buffer as soon as it is traced, and onTile is then called on
+    // the thread that traced it (from several threads at once). Once *cancel
+    // is set, tiles that have not started are skipped. Returns false when
+    // cancelled or when the buffer does not fit.
+    bool renderInto(const FrameBuffer& buffer, const TileCallback& onTile = {},
+                    const std::atomic<bool>* cancel = nullptr);
+    // render() on a thread of its own; returns at once. The render takes a
+    // snapshot of the settings and shares the compiled scene and the thread
+    // pool, so this tracer may be changed, render again or start more async
+    // renders (of the same scene or another) while it runs. Checkpoints are
+    // not written. A pool set with setThreadPool must outlive the render.
+    RenderHandle renderAsync();
+    // renderBands straight into an encoder: memory stays bounded by bandRows.
+    bool renderImage(const std::string& path, ImageFormat format, int bandRows);
+    bool renderPNG(const std::string& path, int bandRows) { return renderImage(path, ImageFormat::Png, bandRows); }
+
+    // 0 = one thread per hardware thread, 1 = serial render on the calling thread
+    void setThreadCount(int count) { m_ThreadCount = count; }
+    // Renders on pool, which the caller owns and may share between tracers,
+    // instead of a pool of its own sized by setThreadCount. nullptr undoes it.
+    void setThreadPool(ThreadPool* pool) { m_SharedPool = pool; }
+    void setTileSize(int size) { m_TileSize = size > 0 ? size : 1; }
+    // Camera rays per SIMD packet: 1 (scalar), 4 or 8; 0 = widest the active kernels offer
+    void setPacketWidth(int width) { m_PacketWidth = width; }
+    void setEngine(RenderEngine engine) { m_Engine = engine; }
+    // Mirror/glass bounces followed before a path is cut off (and left black)
+    void setMaxDepth(int depth) { m_MaxDepth = depth > 0 ? depth : 0; }
+    // Deflate level of the PNG output: 0 (store) to 9 (smallest)
+    void setPngLevel(int level) { m_PngLevel = level; }
+    // Tone map, exposure and transfer curve of the 8-bit output
+    void setPostProcess(const PostProcess& post) { m_PostProcess = post; }
+    // Full-frame renders (renderHDR, render) append each tile to path as it
+    // finishes, flushed at least every intervalSeconds, and delete the file
+    // once the frame is complete.
+    // An empty path turns checkpoints off. Banded renders do not checkpoint.
+    void setCheckpoint(const std::string& path, double intervalSeconds)
+    {
+        m_CheckpointPath = path;
+        m_CheckpointInterval = intervalSeconds;
+    }
+    // Start from the checkpoint file, if one for this scene and these settings exists.
+    void setResume(bool resume) { m_Resume = resume; }
+    // Traces only the pixels inside window (clipped to the frame), with the
+    // camera rays of the full frame, so they equal the same pixels of a full
+    // render. The output is the window alone or, with keepFullFrame, the
+    // whole frame with everything outside the window left black. An empty
+    // window renders the full frame.
+    void setCrop(const PixelRect& window, bool keepFullFrame)
+    {
+        m_Crop = window;
+        m_CropKeepsFrame = keepFullFrame;
+    }
+    // Picture aspect (width / height) the scene's screen window is refitted
+    // to, keeping its height; 0 uses the screen window as the scene sets it.
+    void setScreenAspect(float aspect) { m_ScreenAspect = aspect; }
+    // Renders from camera instead of the scene's own; nullopt goes back to the scene's.
+    void setCamera(const std::optional<CameraParams>& camera) { m_CameraOverride = camera; }
+
+    // Size of the images the render calls produce (the crop window, unless the full frame is kept).
+    int outputWidth() const { return outputRect().width(); }
+    int outputHeight() const { return outputRect().height(); }
+
+    const LoadStats& loadStats() const { return m_LoadStats; }
+    // Stage timings of the last wavefront render (all zero for the recursive engine).
+    const WavefrontStats& wavefrontStats() const { return m_WavefrontStats; }
+    // Shadow queries of the last render and how many the last-occluder cache answered.
+    const OcclusionStats& occlusionStats() const { return m_OcclusionStats; }
+    const CheckpointStats& checkpointStats() const { return m_CheckpointStats; }
 
   private:
+    // The pixels that are traced, and the part of the frame the output covers.
+    PixelRect traceRect() const;
+    PixelRect outputRect() const;
+    // Tiles covering the traced pixels of frame rows [y0, y1).
+    std::vector<Tile> makeTiles(int y0, int y1) const;
+    // Resets the per-render statistics and makes sure the scene is compiled.
+    void beginRender();
+    // Renders the traced pixels of frame rows [y0, y1) into target.
+    void renderRows(int y0, int y1, const FrameTarget& target);
+    // Renders tiles[indices[i]] for every i into target or, when target has
+    // no pixels, into scratch storage per tile. finished runs on the tracing
+    // thread once a tile is done. Tiles not started once *cancel is set are
+    // skipped; returns false if any were.
+    using TileFinished = std::function<void(const Tile& tile, const FrameTarget& pixels)>;
+    bool renderTiles(const std::vector<Tile>& tiles, const std::vector<size_t>& indices, const FrameTarget& target,
+                     const TileFinished& finished = {}, const std::atomic<bool>* cancel = nullptr);
+    // Traces the camera ray of the first pixel of every block x block square
+    // of the traced pixels: columns x rows samples, row-major.
+    std::vector<glm::vec3> traceSamples(int block, int columns, int rows);
+    // renderRows for the whole frame, appending every finished tile to the checkpoint.
+    void renderCheckpointed(const FrameTarget& target);
+    // Quantizes pixelCount pixels of frame to 8-bit RGB, in parallel chunks.
+    void postProcess(const glm::vec3* frame, size_t pixelCount, unsigned char* pixels);
+    // cache belongs to the tile (and so to the one thread rendering it).
+    void renderTile(const Tile& tile, int packetWidth, OccluderCache& cache, const FrameTarget& target) const;
+    void renderTileWavefront(const Tile& tile, int packetWidth, OccluderCache& cache, const FrameTarget& target,
+                             WavefrontStats& stats) const;
+    bool loadSceneData(const char* data, size_t size, MappedFile file, const std::string& name,
+                       std::chrono::steady_clock::time_point start);
+    ThreadPool& threadPool();
+    // A writer for format, with the PNG settings of this tracer applied.
+    std::unique_ptr<ImageStreamWriter> makeWriter(ImageFormat format);
+
+    // Traces count (<= packetWidth) camera rays with one SIMD primary-visibility query.
+    void tracePacket(const Ray* rays, int count, int packetWidth, OccluderCache& cache, glm::vec3* outColors) const;
+
     bool closestHit(const Ray& ray, float tMin, float tMax, HitInfo& outHit) const;
-    bool isShadowed(const glm::vec3& origin, const glm::vec3& dir, float maxDist, const Object* ignore) const;
-    glm::vec3 trace(const Ray& ray, int depth) const;
-    glm::vec3 shade(const HitInfo& hit, const Ray& ray, int depth) const;
-    glm::vec3 handleTransparency(const HitInfo& hit, const Ray& ray, int depth) const;
+    void fillHit(const Ray& ray, PrimitiveRef prim, float t, HitInfo& outHit) const;
+    glm::vec3 trace(const Ray& ray, int depth, OccluderCache& cache) const;
+    // Follows the path from its hit on ray to the opaque surface that ends it; hit is reused as scratch.
+    glm::vec3 traceHit(HitInfo& hit, const Ray& ray, int depth, OccluderCache& cache) const;
+    glm::vec3 shade(const HitInfo& hit, const Ray& ray, OccluderCache& cache) const;
 
   private:
     Scene m_Scene{};
+    std::shared_ptr<const CompiledScene> m_Compiled;
+    std::shared_ptr<SceneDiskCache> m_DiskCache;
+    const KernelTable* m_Kernels{nullptr};
     int m_Width;
     int m_Height;
     int m_MaxDepth{5};
     float m_Epsilon{1e-4f};
+    int m_ThreadCount{0};
+    int m_TileSize{32};
+    int m_PacketWidth{0};
+    RenderEngine m_Engine{RenderEngine::Recursive};
+    int m_PngLevel{kDeflateDefaultLevel};
+    PostProcess m_PostProcess{};
+    std::string m_CheckpointPath;
+    double m_CheckpointInterval{60.0};
+    bool m_Resume{false};
+    PixelRect m_Crop{};
+    bool m_CropKeepsFrame{false};
+    float m_ScreenAspect{0.0f};
+    std::optional<CameraParams> m_CameraOverride;
+    CompiledCamera m_Camera;  // the scene's camera at this resolution and aspect
+    LoadStats m_LoadStats{};
+    WavefrontStats m_WavefrontStats{};
+    OcclusionStats m_OcclusionStats{};
+    CheckpointStats m_CheckpointStats{};
+    std::shared_ptr<ThreadPool> m_Pool;  // shared with the async renders still using it
+    ThreadPool* m_SharedPool{nullptr};
 };
@@ -0,0 +1,599 @@
+#include <RenderCli.h>
+#include <BatchRender.h>
+#include <HdrWriter.h>
+#include <RayTracer.h>
+#include <RenderServer.h>
+
+#include <iomanip>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <exception>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <chrono>
+#include <csignal>
+#include <future>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace {
+    constexpr int kProgressIntervalMs = 100;
+
+    volatile std::sig_atomic_t g_Interrupted = 0;
+
+    void onInterrupt(int)
+    {
+        g_Interrupted = 1;
+    }
+
+    // Discover scene definition files so the user can choose one interactively.
+    std::vector<std::string> discoverSceneFiles()
+    {
+        std::vector<std::string> scenes;
+        std::set<std::string> seen;
+        std::vector<std::string> searchRoots = {".", ".."};
+
+        for (const auto& root : searchRoots) {
+            DIR* dir = opendir(root.c_str());
+            if (!dir) {
+                continue;
+            }
+
+            while (dirent* entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name == "." || name == "..") {
+                    continue;
+                }
+
+                std::string path = root + "/" + name;
+                struct stat st{};
+                if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+                    continue;
+                }
+
+                const size_t extLen = 4; // ".txt"
+                if (name.size() <= extLen || name.compare(name.size() - extLen, extLen, ".txt") != 0) {
+                    continue;
+                }
+
+                std::string stem = name.substr(0, name.size() - extLen);
+                if (stem.rfind("scene", 0) != 0) {
+                    continue;
+                }
+
+                if (seen.insert(path).second) {
+                    scenes.push_back(path);
+                }
+            }
+
+            closedir(dir);
+        }
+
+        std::sort(scenes.begin(), scenes.end());
+        return scenes;
+    }
+
+    bool hasExtension(const std::string& path, const std::string& ext)
+    {
+        if (path.size() < ext.size()) {
+            return false;
+        }
+        return std::equal(ext.begin(), ext.end(), path.end() - static_cast<std::ptrdiff_t>(ext.size()),
+                          [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); });
+    }
+
+    // "X,Y,W,H": the window's top-left pixel and its size.
+    bool parseCrop(const std::string& text, PixelRect& window)
+    {
+        int values[4] = {};
+        size_t start = 0;
+        for (int i = 0; i < 4; ++i) {
+            size_t comma = text.find(',', start);
+            if ((comma == std::string::npos) != (i == 3)) {
+                return false;
+            }
+            std::string part = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+            try {
+                size_t end = 0;
+                values[i] = std::stoi(part, &end);
+                if (end != part.size()) {
+                    return false;
+                }
+            } catch (const std::exception&) {
+                return false;
+            }
+            start = comma + 1;
+        }
+        window = {values[0], values[1], values[0] + values[2], values[1] + values[3]};
+        return values[0] >= 0 && values[1] >= 0 && values[2] > 0 && values[3] > 0;
+    }
+
+    // The render's statistics go to occlusion and wavefront, since it does
+    // not run on tracer itself.
+    bool renderWithProgress(RayTracer& tracer, const std::string& outputPath, OcclusionStats& occlusion,
+                            WavefrontStats& wavefront)
+    {
+        // The render runs in the background while this thread keeps a progress
+        // line up to date; Ctrl-C cancels it, which ends it within a tile.
+        g_Interrupted = 0;
+        auto previousHandler = std::signal(SIGINT, onInterrupt);
+        RenderHandle render = tracer.renderAsync();
+        const auto interval = std::chrono::milliseconds(kProgressIntervalMs);
+        while (render.future().wait_for(interval) != std::future_status::ready) {
+            if (g_Interrupted) {
+                render.cancel();
+            }
+            std::cerr << "\rRendering " << static_cast<int>(render.progress() * 100.0f) << "%" << std::flush;
+        }
+        std::signal(SIGINT, previousHandler);
+        const RenderResult& result = render.future().get();
+        occlusion = result.occlusion;
+        wavefront = result.wavefront;
+        if (result.cancelled) {
+            std::cerr << "\rRender cancelled at " << static_cast<int>(render.progress() * 100.0f) << "%" << std::endl;
+            return false;
+        }
+        std::cerr << "\rRendering 100%" << std::endl;
+        return tracer.writeImage(outputPath, imageFormatForPath(outputPath), result.pixels);
+    }
+
+    bool renderByDeadline(RayTracer& tracer, const std::string& outputPath, int deadlineMs)
+    {
+        const DeadlineRender result =
+            tracer.render(std::chrono::steady_clock::now() + std::chrono::milliseconds(deadlineMs));
+        std::cout << std::fixed << std::setprecision(1) << "Refined " << result.tilesRefined << " of "
+                  << result.tileCount << " tiles (" << result.refinedFraction * 100.0f << "% of the pixels) in "
+                  << result.seconds * 1000.0 << " ms of " << deadlineMs << " ms, after a "
+                  << result.coarseSeconds * 1000.0 << " ms coarse pass; estimated quality " << std::setprecision(3)
+                  << result.quality << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        return tracer.writeImage(outputPath, imageFormatForPath(outputPath), result.pixels);
+    }
+}
+
+bool parseResolution(const std::string& text, int& width, int& height)
+{
+    size_t cross = text.find('x');
+    try {
+        size_t end = 0;
+        width = std::stoi(text.substr(0, cross), &end);
+        if (end != (cross == std::string::npos ? text.size() : cross)) {
+            return false;
+        }
+        height = 0;
+        if (cross != std::string::npos) {
+            height = std::stoi(text.substr(cross + 1), &end);
+            if (end != text.size() - cross - 1 || height <= 0) {
+                return false;
+            }
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return width > 0;
+}
+
+bool parseAspect(const std::string& text, float& aspect)
+{
+    size_t colon = text.find(':');
+    try {
+        size_t end = 0;
+        aspect = std::stof(text.substr(0, colon), &end);
+        if (end != (colon == std::string::npos ? text.size() : colon)) {
+            return false;
+        }
+        if (colon != std::string::npos) {
+            float denominator = std::stof(text.substr(colon + 1), &end);
+            if (end != text.size() - colon - 1 || !(denominator > 0.0f)) {
+                return false;
+            }
+            aspect /= denominator;
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return aspect > 0.0f;
+}
+
+bool renderToFile(RayTracer& tracer, const std::string& outputPath, int bandRows)
+{
+    const bool pfm = hasExtension(outputPath, ".pfm");
+    if (pfm || hasExtension(outputPath, ".exr")) {
+        // HDR output skips the post stage; tone mapping is left to the consumer.
+        const std::vector<glm::vec3> frame = tracer.renderHDR();
+        const int outWidth = tracer.outputWidth();
+        const int outHeight = tracer.outputHeight();
+        return pfm ? writePFM(outputPath, &frame[0].x, outWidth, outHeight)
+                   : writeEXR(outputPath, &frame[0].x, outWidth, outHeight);
+    }
+    const ImageFormat format = imageFormatForPath(outputPath);
+    if (bandRows > 0) {
+        // Streamed: each band is encoded as soon as it is traced, so memory
+        // stays bounded by the band size whatever the image height.
+        return tracer.renderImage(outputPath, format, bandRows);
+    }
+    const std::vector<unsigned char> pixels = tracer.render();
+    return tracer.writeImage(outputPath, format, pixels);
+}
+
+void applyRenderSettings(const RenderSettings& settings, RayTracer& tracer)
+{
+    tracer.setThreadCount(settings.threadCount);
+    tracer.setTileSize(settings.tileSize);
+    tracer.setPacketWidth(settings.packetWidth);
+    tracer.setEngine(settings.engine);
+    tracer.setMaxDepth(settings.maxDepth);
+    tracer.setPngLevel(settings.pngLevel);
+    tracer.setPostProcess(settings.post);
+}
+
+int runRenderCli(int argc, char* argv[])
+{
+    std::string scenePath = "scene1.txt";
+    std::string outputPath = "render.png";
+    RenderSettings settings;
+    int bandRows = 0;  // 0 = render the whole frame, then encode it
+    std::string checkpointPath;  // empty = <output>.ckpt when checkpointing
+    double checkpointInterval = 0.0;  // 0 = no checkpoints
+    bool resume = false;
+    bool showProgress = false;
+    int deadlineMs = 0;  // 0 = render every pixel, however long it takes
+    int width = 1000;
+    int height = 0;  // 0 = from the width and the aspect (square without one)
+    float aspect = 0.0f;  // 0 = the scene's screen window as it is
+    PixelRect crop{};
+    bool cropFull = false;
+    std::string servePath;  // non-empty = run as a render server on this socket
+    std::string manifestPath;  // non-empty = render the entries of this batch manifest
+    int sceneCacheSize = 16;
+    std::string diskCacheDir;  // non-empty = compiled scenes cached in this directory
+    int diskCacheMegabytes = 1024;
+
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--threads" || arg == "--tile-size" || arg == "--packet-width" || arg == "--max-depth" ||
+             arg == "--band-rows" || arg == "--png-level" || arg == "--scene-cache" ||
+             arg == "--scene-cache-mb" || arg == "--deadline") &&
+            i + 1 < argc) {
+            int value = 0;
+            try {
+                value = std::stoi(argv[++i]);
+            } catch (const std::exception&) {
+                value = -1;
+            }
+            const bool positive =
+                arg == "--tile-size" || arg == "--scene-cache" || arg == "--scene-cache-mb" || arg == "--deadline";
+            if (value < 0 || (positive && value == 0)) {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+                return 1;
+            }
+            if (arg == "--png-level" && value > kDeflateMaxLevel) {
+                std::cerr << "PNG level must be 0 to " << kDeflateMaxLevel << std::endl;
+                return 1;
+            }
+            if (arg == "--packet-width" && value != 0 && value != 1 && value != 4 && value != 8) {
+                std::cerr << "Packet width must be 0, 1, 4 or 8" << std::endl;
+                return 1;
+            }
+            (arg == "--threads"          ? settings.threadCount
+             : arg == "--tile-size"      ? settings.tileSize
+             : arg == "--max-depth"      ? settings.maxDepth
+             : arg == "--band-rows"      ? bandRows
+             : arg == "--png-level"      ? settings.pngLevel
+             : arg == "--scene-cache"    ? sceneCacheSize
+             : arg == "--scene-cache-mb" ? diskCacheMegabytes
+             : arg == "--deadline"       ? deadlineMs
+                                         : settings.packetWidth) = value;
+        } else if (arg == "--isa" && i + 1 < argc) {
+            Isa isa = Isa::Generic;
+            if (!parseIsa(argv[++i], isa)) {
+                std::cerr << "Unknown ISA: " << argv[i] << " (expected generic, sse4.2, avx2 or avx512)" << std::endl;
+                return 1;
+            }
+            if (!forceIsa(isa)) {
+                std::cerr << "This CPU cannot run the " << isaName(isa) << " kernels" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--tonemap" && i + 1 < argc) {
+            if (!parseToneMap(argv[++i], settings.post.toneMap)) {
+                std::cerr << "Unknown tone map: " << argv[i] << " (expected clamp, reinhard or aces)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--exposure" && i + 1 < argc) {
+            try {
+                settings.post.exposure = std::stof(argv[++i]);
+            } catch (const std::exception&) {
+                settings.post.exposure = -1.0f;
+            }
+            if (!(settings.post.exposure > 0.0f)) {
+                std::cerr << "Invalid value for --exposure: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--srgb") {
+            settings.post.srgb = true;
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpointPath = argv[++i];
+        } else if (arg == "--checkpoint-interval" && i + 1 < argc) {
+            try {
+                checkpointInterval = std::stod(argv[++i]);
+            } catch (const std::exception&) {
+                checkpointInterval = -1.0;
+            }
+            if (!(checkpointInterval > 0.0)) {
+                std::cerr << "Invalid value for --checkpoint-interval: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--resume") {
+            resume = true;
+        } else if (arg == "--progress") {
+            showProgress = true;
+        } else if (arg == "--resolution" && i + 1 < argc) {
+            if (!parseResolution(argv[++i], width, height)) {
+                std::cerr << "Invalid resolution: " << argv[i] << " (expected W or WxH)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--aspect" && i + 1 < argc) {
+            if (!parseAspect(argv[++i], aspect)) {
+                std::cerr << "Invalid aspect ratio: " << argv[i] << " (expected W:H or a ratio)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--crop" && i + 1 < argc) {
+            if (!parseCrop(argv[++i], crop)) {
+                std::cerr << "Invalid crop window: " << argv[i] << " (expected X,Y,W,H)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--crop-full") {
+            cropFull = true;
+        } else if (arg == "--serve" && i + 1 < argc) {
+            servePath = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            manifestPath = argv[++i];
+        } else if (arg == "--scene-cache-dir" && i + 1 < argc) {
+            diskCacheDir = argv[++i];
+        } else if (arg == "--engine" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "recursive") {
+                settings.engine = RenderEngine::Recursive;
+            } else if (name == "wavefront") {
+                settings.engine = RenderEngine::Wavefront;
+            } else {
+                std::cerr << "Unknown engine: " << name << " (expected recursive or wavefront)" << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << "\n"
+                      << "Usage: main [scene.txt] [output.png] [--threads N] [--tile-size N] [--packet-width 0|1|4|8]"
+                      << " [--isa generic|sse4.2|avx2|avx512] [--engine recursive|wavefront]"
+                      << " [--max-depth N] [--band-rows N] [--png-level 0-9]"
+                      << " [--tonemap clamp|reinhard|aces] [--exposure F] [--srgb]"
+                      << " [--checkpoint PATH] [--checkpoint-interval SECONDS] [--resume]"
+                      << " [--resolution W|WxH] [--aspect W:H] [--crop X,Y,W,H] [--crop-full]"
+                      << " [--scene-cache-dir DIR] [--scene-cache-mb N] [--progress]"
+                      << " [--deadline MS]\n"
+                      << "       main --serve SOCKET [--scene-cache N] [--deadline MS] [render settings]\n"
+                      << "       main --batch MANIFEST [render settings]\n"
+                      << "--aspect refits the scene's screen window to the ratio; with only a width it also sets\n"
+                      << "the height. --crop traces just that window and writes it alone, or the whole frame\n"
+                      << "with the rest black with --crop-full.\n"
+                      << "The output format follows the extension: .ppm, .qoi, .rgb/.raw (headerless RGB),\n"
+                      << ".pfm or .exr (unclamped float image), anything else PNG.\n"
+                      << "--serve renders jobs sent to a Unix socket (see RenderServer.h) on one thread pool,\n"
+                      << "keeping the last N compiled scenes; the settings given apply to every job.\n"
+                      << "--batch renders every entry of a manifest (see BatchRender.h) on one thread pool,\n"
+                      << "loading each scene once; --resolution and --aspect are the entries' defaults.\n"
+                      << "--scene-cache-dir keeps compiled scenes and their BVHs in DIR, keyed by the scene\n"
+                      << "text, up to --scene-cache-mb megabytes (default 1024); unchanged scenes skip parsing\n"
+                      << "and the BVH build.\n"
+                      << "--progress shows how much of the frame is done while rendering; Ctrl-C then cancels\n"
+                      << "the render.\n"
+                      << "--deadline gives the render (not the scene load) MS milliseconds: a coarse pass of one\n"
+                      << "ray per 4x4 pixels, then full-resolution tiles where it is least accurate first, for as\n"
+                      << "long as they fit." << std::endl;
+            return 1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    std::shared_ptr<SceneDiskCache> diskCache;
+    if (!diskCacheDir.empty()) {
+        diskCache = std::make_shared<SceneDiskCache>(diskCacheDir, static_cast<uint64_t>(diskCacheMegabytes) << 20);
+    }
+
+    if (!servePath.empty()) {
+        if (!positional.empty() || !manifestPath.empty() || bandRows > 0 || checkpointInterval > 0.0 || resume ||
+            !checkpointPath.empty() || aspect > 0.0f || !crop.empty() || showProgress) {
+            std::cerr << "--serve takes no scene, output or manifest, and no band, checkpoint, progress, aspect or"
+                      << " crop options"
+                      << std::endl;
+            return 1;
+        }
+        RenderServerOptions options;
+        options.socketPath = servePath;
+        options.sceneCacheSize = static_cast<size_t>(sceneCacheSize);
+        options.width = width;
+        options.height = height;
+        options.settings = settings;
+        options.diskCache = diskCache;
+        options.deadlineMs = deadlineMs;
+        return runRenderServer(options);
+    }
+
+    if (!manifestPath.empty()) {
+        if (!positional.empty() || checkpointInterval > 0.0 || resume || !checkpointPath.empty() || !crop.empty() ||
+            showProgress || deadlineMs > 0) {
+            std::cerr << "--batch takes no scene or output, and no checkpoint, progress, deadline or crop options"
+                      << std::endl;
+            return 1;
+        }
+        BatchOptions options;
+        options.manifestPath = manifestPath;
+        options.settings = settings;
+        options.width = width;
+        options.height = height;
+        options.aspect = aspect;
+        options.bandRows = bandRows;
+        options.diskCache = diskCache;
+        return runBatch(options);
+    }
+
+    if (positional.size() >= 1) {
+        scenePath = positional[0];
+    }
+    if (positional.size() >= 2) {
+        outputPath = positional[1];
+    }
+
+    if (positional.empty()) {
+        auto scenes = discoverSceneFiles();
+        if (!scenes.empty()) {
+            std::cout << "Available scenes:\n";
+            for (size_t i = 0; i < scenes.size(); ++i) {
+                std::cout << "  [" << i + 1 << "] " << scenes[i] << "\n";
+            }
+            std::cout << "Pick a scene number or enter a path (empty to exit): " << std::flush;
+
+            std::string input;
+            std::getline(std::cin, input);
+            if (input.empty()) {
+                std::cout << "No selection made. Exiting without rendering.\n";
+                return 0;
+            }
+
+            try {
+                size_t idxEnd = 0;
+                int idx = std::stoi(input, &idxEnd);
+                if (idxEnd == input.size() && idx >= 1 && static_cast<size_t>(idx) <= scenes.size()) {
+                    scenePath = scenes[static_cast<size_t>(idx) - 1];
+                } else {
+                    scenePath = input;
+                }
+            } catch (const std::exception&) {
+                scenePath = input;
+            }
+        }
+    }
+
+    // Allow running from the bin directory by falling back to parent path
+    auto pathExists = [](const std::string& path) {
+        std::ifstream f(path);
+        return f.good();
+    };
+
+    if (!pathExists(scenePath)) {
+        std::string parentCandidate = std::string("..") + "/" + scenePath;
+        if (pathExists(parentCandidate)) {
+            scenePath = parentCandidate;
+        }
+    }
+
+    if (height == 0) {
+        height = aspect > 0.0f ? std::max(1, static_cast<int>(std::lround(width / aspect))) : width;
+    }
+    if (!crop.empty() && (crop.x1 > width || crop.y1 > height)) {
+        std::cerr << "Crop window " << crop.x0 << "," << crop.y0 << "," << crop.width() << "," << crop.height()
+                  << " does not fit the " << width << "x" << height << " frame" << std::endl;
+        return 1;
+    }
+
+    RayTracer tracer(width, height);
+    applyRenderSettings(settings, tracer);
+    tracer.setScreenAspect(aspect);
+    tracer.setCrop(crop, cropFull);
+    if (checkpointInterval > 0.0 || resume || !checkpointPath.empty()) {
+        if (bandRows > 0) {
+            std::cerr << "Checkpoints need a full-frame render; drop --band-rows" << std::endl;
+            return 1;
+        }
+        if (checkpointPath.empty()) {
+            checkpointPath = outputPath + ".ckpt";
+        }
+        tracer.setCheckpoint(checkpointPath, checkpointInterval > 0.0 ? checkpointInterval : 60.0);
+        tracer.setResume(resume);
+    }
+    if ((showProgress || deadlineMs > 0) && (bandRows > 0 || !checkpointPath.empty() ||
+                                             hasExtension(outputPath, ".pfm") || hasExtension(outputPath, ".exr"))) {
+        std::cerr << (showProgress ? "--progress" : "--deadline")
+                  << " needs a full-frame 8-bit render: no .pfm or .exr output, --band-rows or checkpoints"
+                  << std::endl;
+        return 1;
+    }
+    if (showProgress && deadlineMs > 0) {
+        std::cerr << "--progress and --deadline cannot be combined" << std::endl;
+        return 1;
+    }
+    tracer.setSceneDiskCache(diskCache);
+    if (!tracer.loadScene(scenePath)) {
+        std::cerr << "Failed to load scene: " << scenePath << std::endl;
+        return 1;
+    }
+
+    const LoadStats& load = tracer.loadStats();
+    const bool parsed = !load.binary && !load.cacheHit;
+    std::cout << (parsed ? "Parsed " : "Mapped ") << scenePath << (load.cacheHit ? " from the scene cache" : "")
+              << ": " << std::fixed << std::setprecision(2) << static_cast<double>(load.bytes) / 1e6 << " MB in "
+              << load.parseSeconds * 1000.0 << " ms";
+    if (parsed && load.parseSeconds > 0.0) {
+        std::cout << " (" << static_cast<double>(load.bytes) / 1e6 / load.parseSeconds << " MB/s), compiled in "
+                  << load.compileSeconds * 1000.0 << " ms";
+    }
+    std::cout << std::endl;
+    if (diskCache) {
+        const SceneDiskCacheStats stats = diskCache->stats();
+        std::cout << "Scene cache " << diskCache->directory() << ": " << (stats.hits > 0 ? "hit" : "miss") << ", "
+                  << static_cast<double>(diskCache->sizeBytes()) / 1e6 << " of "
+                  << static_cast<double>(diskCache->maxBytes()) / 1e6 << " MB used";
+        if (stats.evictions > 0) {
+            std::cout << ", " << stats.evictions << " entries evicted";
+        }
+        std::cout << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+
+    OcclusionStats occlusion{};
+    WavefrontStats wavefront{};
+    const bool rendered = showProgress     ? renderWithProgress(tracer, outputPath, occlusion, wavefront)
+                          : deadlineMs > 0 ? renderByDeadline(tracer, outputPath, deadlineMs)
+                                           : renderToFile(tracer, outputPath, bandRows);
+    if (!rendered) {
+        return 1;
+    }
+    if (!showProgress) {
+        occlusion = tracer.occlusionStats();
+        wavefront = tracer.wavefrontStats();
+    }
+
+    if (settings.engine == RenderEngine::Wavefront) {
+        // Thread-seconds: with several threads the stages overlap in wall time.
+        const WavefrontStats& stats = wavefront;
+        std::cout << "Wavefront stages (summed over threads):\n";
+        for (int i = 0; i < kWavefrontStageCount; ++i) {
+            std::cout << "  " << std::left << std::setw(12) << wavefrontStageName(static_cast<WavefrontStage>(i))
+                      << std::right << std::fixed << std::setprecision(2) << std::setw(10)
+                      << stats.seconds[i] * 1000.0 << " ms " << std::setw(10) << stats.items[i] << " items\n";
+        }
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    const CheckpointStats& checkpoint = tracer.checkpointStats();
+    if (checkpoint.tilesResumed > 0 || checkpoint.tilesSaved > 0) {
+        std::cout << "Checkpoint " << checkpointPath << ": resumed " << checkpoint.tilesResumed << " of "
+                  << checkpoint.tileCount << " tiles, saved " << checkpoint.tilesSaved << " tiles" << std::endl;
+    }
+
+    if (occlusion.queries > 0) {
+        std::cout << "Shadow queries: " << occlusion.queries << ", answered by the last-occluder cache: "
+                  << occlusion.cacheHits << " (" << std::fixed << std::setprecision(1)
+                  << 100.0 * static_cast<double>(occlusion.cacheHits) / static_cast<double>(occlusion.queries)
+                  << "%)" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    std::cout << "Rendered " << scenePath << " -> " << outputPath << " (" << tracer.outputWidth() << "x"
+              << tracer.outputHeight() << ", " << activeKernels().name << " kernels)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <RayTracer.h>
+
+#include <string>
+
+// Settings every front end applies to each image it renders: the command
+// line, server jobs and batch entries. See the command-line options of the
+// same names.
+struct RenderSettings {
+    int threadCount{0};
+    int tileSize{32};
+    int packetWidth{0};
+    int maxDepth{5};
+    int pngLevel{kDeflateDefaultLevel};
+    RenderEngine engine{RenderEngine::Recursive};
+    PostProcess post{};
+};
+
+void applyRenderSettings(const RenderSettings& settings, RayTracer& tracer);
+
+// The render command line: parses the arguments, renders the scene and
+// writes the image. Shared by bin/main and the headless bin/render_headless;
+// returns the process exit code.
+int runRenderCli(int argc, char* argv[]);
+// Renders tracer's scene into outputPath, in the format its extension names
+// (see the usage text); bandRows > 0 streams 8-bit output in bands.
+bool renderToFile(RayTracer& tracer, const std::string& outputPath, int bandRows);
+
+// "W" or "WxH" (height 0 when left out), as --resolution takes it.
+bool parseResolution(const std::string& text, int& width, int& height);
+// "W:H" or a plain ratio such as "1.7778", as --aspect takes it.
+bool parseAspect(const std::string& text, float& aspect);
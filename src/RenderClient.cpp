@@ -0,0 +1,387 @@
+// Client of the render server (bin/main --serve SOCKET, see RenderServer.h).
+// Sends one job per scene and resolution, or --jobs jobs spread over
+// --concurrency connections, cycling through the scenes and resolutions;
+// several jobs are reported as latency percentiles and throughput.
+//
+//   render_client SOCKET [--output PATH|-] [--resolution W|WxH]... [--inline]
+//                 [--deadline MS] [--jobs N] [--concurrency N] SCENE...
+//   render_client SOCKET --stats | --shutdown
+//
+// Scene paths are sent as absolute paths, or with --inline the scene text
+// itself is sent. The default output "-" has the pixels sent back and
+// dropped, which keeps disk writes out of the measurement.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <climits>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+int main()
+{
+    std::cerr << "render_client needs Unix domain sockets, which this build does not support" << std::endl;
+    return 1;
+}
+
+#else
+
+namespace {
+    class Connection {
+      public:
+        Connection() = default;
+        ~Connection()
+        {
+            if (m_Fd >= 0) {
+                ::close(m_Fd);
+            }
+        }
+
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+
+        bool open(const std::string& path)
+        {
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(address.sun_path)) {
+                std::cerr << "Socket path too long: " << path << std::endl;
+                return false;
+            }
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+            m_Fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (m_Fd < 0 || ::connect(m_Fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+                std::cerr << "Cannot connect to " << path << ": " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        bool write(const std::string& text)
+        {
+            size_t done = 0;
+            while (done < text.size()) {
+                ssize_t sent = ::send(m_Fd, text.data() + done, text.size() - done, 0);
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (sent <= 0) {
+                    return false;
+                }
+                done += static_cast<size_t>(sent);
+            }
+            return true;
+        }
+
+        bool readLine(std::string& line)
+        {
+            size_t newline;
+            while ((newline = m_Buffer.find('\n')) == std::string::npos) {
+                if (!fill()) {
+                    return false;
+                }
+            }
+            line = m_Buffer.substr(0, newline);
+            m_Buffer.erase(0, newline + 1);
+            return true;
+        }
+
+        bool skipBytes(size_t count)
+        {
+            while (m_Buffer.size() < count) {
+                count -= m_Buffer.size();
+                m_Buffer.clear();
+                if (!fill()) {
+                    return false;
+                }
+            }
+            m_Buffer.erase(0, count);
+            return true;
+        }
+
+      private:
+        bool fill()
+        {
+            char chunk[64 * 1024];
+            ssize_t received;
+            do {
+                received = ::recv(m_Fd, chunk, sizeof(chunk), 0);
+            } while (received < 0 && errno == EINTR);
+            if (received <= 0) {
+                return false;
+            }
+            m_Buffer.append(chunk, static_cast<size_t>(received));
+            return true;
+        }
+
+      private:
+        int m_Fd{-1};
+        std::string m_Buffer;
+    };
+
+    struct JobResult {
+        bool ok{false};
+        bool hit{false};
+        double quality{-1.0};  // -1 = not a deadline render
+        double seconds{0.0};
+        std::string reply;
+    };
+
+    // Sends request and reads the answer to its "render", skipping any pixels.
+    bool runJob(Connection& connection, const std::string& request, JobResult& result)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        if (!connection.write(request) || !connection.readLine(result.reply)) {
+            return false;
+        }
+        std::istringstream fields(result.reply);
+        std::string status, cache;
+        int width = 0, height = 0;
+        size_t bytes = 0;
+        double serverMs = 0.0;
+        double quality = 0.0;
+        fields >> status >> width >> height >> bytes >> serverMs >> cache;
+        if (fields >> quality) {
+            result.quality = quality;
+        }
+        result.ok = status == "ok";
+        result.hit = cache == "hit";
+        if (result.ok && bytes > 0 && !connection.skipBytes(bytes)) {
+            return false;
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    // Nearest-rank percentile of sorted values.
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        size_t rank = static_cast<size_t>(std::max(1.0, std::ceil(p / 100.0 * sorted.size())));
+        return sorted[std::min(rank, sorted.size()) - 1];
+    }
+
+    bool readFile(const std::string& path, std::string& contents)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            return false;
+        }
+        std::ostringstream buffer;
+        buffer << in.rdbuf();
+        contents = buffer.str();
+        return true;
+    }
+
+    // The server has its own working directory, so relative paths are resolved here.
+    std::string absolutePath(const std::string& path)
+    {
+        char cwd[PATH_MAX];
+        if (path.empty() || path[0] == '/' || !::getcwd(cwd, sizeof(cwd))) {
+            return path;
+        }
+        return std::string(cwd) + "/" + path;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::cerr << "Usage: render_client SOCKET [--output PATH|-] [--resolution W|WxH]... [--inline]"
+                  << " [--deadline MS] [--jobs N] [--concurrency N] SCENE...\n"
+                  << "       render_client SOCKET --stats | --shutdown" << std::endl;
+        return 1;
+    }
+    const std::string socketPath = argv[1];
+    std::string output = "-";
+    std::vector<std::string> resolutions;
+    bool inlineScenes = false;
+    int jobCount = 0;  // 0 = each scene at each resolution once
+    int concurrency = 1;
+    int deadlineMs = 0;  // 0 = the server's default
+    std::vector<std::string> scenes;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--stats" || arg == "--shutdown") {
+            Connection connection;
+            std::string reply;
+            if (!connection.open(socketPath) || !connection.write(arg.substr(2) + "\n") ||
+                !connection.readLine(reply)) {
+                return 1;
+            }
+            if (arg == "--stats") {
+                std::istringstream fields(reply);
+                std::string status;
+                unsigned long long jobs = 0, hits = 0, misses = 0, evictions = 0, entries = 0;
+                fields >> status >> jobs >> hits >> misses >> evictions >> entries;
+                std::cout << jobs << " jobs served; scene cache: " << entries << " scenes, " << hits << " hits, "
+                          << misses << " misses, " << evictions << " evictions" << std::endl;
+            }
+            return reply.rfind("ok", 0) == 0 ? 0 : 1;
+        } else if (arg == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--resolution" && i + 1 < argc) {
+            resolutions.push_back(argv[++i]);
+        } else if (arg == "--inline") {
+            inlineScenes = true;
+        } else if ((arg == "--jobs" || arg == "--concurrency" || arg == "--deadline") && i + 1 < argc) {
+            int value = 0;
+            try {
+                value = std::stoi(argv[++i]);
+            } catch (const std::exception&) {
+                value = 0;
+            }
+            if (value <= 0) {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+                return 1;
+            }
+            (arg == "--jobs" ? jobCount : arg == "--concurrency" ? concurrency : deadlineMs) = value;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        } else {
+            scenes.push_back(arg);
+        }
+    }
+    if (scenes.empty()) {
+        std::cerr << "No scene given" << std::endl;
+        return 1;
+    }
+    if (resolutions.empty()) {
+        resolutions.push_back("");  // the server's default
+    }
+    if (output != "-") {
+        output = absolutePath(output);
+    }
+
+    // The request of every scene and resolution pair, ready to send.
+    std::vector<std::string> requests;
+    for (const std::string& scene : scenes) {
+        std::string sceneLine;
+        if (inlineScenes) {
+            std::string text;
+            if (!readFile(scene, text)) {
+                std::cerr << "Cannot read " << scene << std::endl;
+                return 1;
+            }
+            sceneLine = "scene-text " + std::to_string(text.size()) + "\n" + text;
+        } else {
+            sceneLine = "scene " + absolutePath(scene) + "\n";
+        }
+        for (const std::string& resolution : resolutions) {
+            requests.push_back(sceneLine + (resolution.empty() ? "" : "resolution " + resolution + "\n") +
+                               (deadlineMs > 0 ? "deadline " + std::to_string(deadlineMs) + "\n" : "") +
+                               "output " + output + "\nrender\n");
+        }
+    }
+    const bool report = jobCount > 0;
+    if (!report) {
+        jobCount = static_cast<int>(requests.size());
+    }
+    concurrency = std::min(concurrency, jobCount);
+
+    // Jobs are handed out in order; each connection sends its next job once
+    // the answer to the previous one is in.
+    std::vector<JobResult> results(static_cast<size_t>(jobCount));
+    std::mutex mutex;
+    int nextJob = 0;
+    bool failed = false;
+    auto worker = [&]() {
+        Connection connection;
+        if (!connection.open(socketPath)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            failed = true;
+            return;
+        }
+        while (true) {
+            int job;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (failed || nextJob == jobCount) {
+                    return;
+                }
+                job = nextJob++;
+            }
+            JobResult& result = results[static_cast<size_t>(job)];
+            if (!runJob(connection, requests[static_cast<size_t>(job) % requests.size()], result)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::cerr << "Connection to the server lost" << std::endl;
+                failed = true;
+                return;
+            }
+        }
+    };
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < concurrency; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (failed) {
+        return 1;
+    }
+
+    int errors = 0;
+    int hits = 0;
+    double qualityTotal = 0.0;
+    int qualityCount = 0;
+    std::vector<double> latencies;
+    for (const JobResult& result : results) {
+        if (!result.ok) {
+            ++errors;
+            if (!report || errors == 1) {
+                std::cerr << result.reply << std::endl;
+            }
+            continue;
+        }
+        hits += result.hit ? 1 : 0;
+        if (result.quality >= 0.0) {
+            qualityTotal += result.quality;
+            ++qualityCount;
+        }
+        latencies.push_back(result.seconds * 1000.0);
+        if (!report) {
+            std::cout << result.reply << std::endl;
+        }
+    }
+    if (report && !latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        double total = 0.0;
+        for (double latency : latencies) {
+            total += latency;
+        }
+        std::cout << std::fixed << std::setprecision(2) << jobCount << " jobs over " << concurrency
+                  << " connections in " << wallSeconds << " s (" << jobCount / wallSeconds << " jobs/s), "
+                  << hits << " scene cache hits, " << errors << " errors\n"
+                  << "latency ms: mean " << total / latencies.size() << ", p50 " << percentile(latencies, 50.0)
+                  << ", p90 " << percentile(latencies, 90.0) << ", p99 " << percentile(latencies, 99.0) << ", max "
+                  << latencies.back() << std::endl;
+        if (qualityCount > 0) {
+            std::cout << "mean estimated quality " << std::setprecision(3) << qualityTotal / qualityCount
+                      << std::endl;
+        }
+    }
+    return errors == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,384 @@
+#include <RenderServer.h>
+#include <SceneCache.h>
+#include <SceneFile.h>
+#include <ThreadPool.h>
+
+#include <iostream>
+
+#ifdef _WIN32
+
+int runRenderServer(const RenderServerOptions&)
+{
+    std::cerr << "The render server needs Unix domain sockets, which this build does not support" << std::endl;
+    return 1;
+}
+
+#else
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    constexpr int kAcceptPollMs = 200;  // how often the accept loop looks for a shutdown
+    constexpr size_t kReadChunk = 64 * 1024;
+    constexpr size_t kMaxInlineScene = size_t{1} << 30;
+    constexpr uint64_t kMaxJobPixels = uint64_t{1} << 26;  // 8192 x 8192
+
+    // Buffered line and byte reads, and complete writes, on a connected socket.
+    class SocketStream {
+      public:
+        explicit SocketStream(int fd) : m_Fd(fd) {}
+
+        // One line without its "\n" (or "\r\n"); false at the end of the stream.
+        bool readLine(std::string& line)
+        {
+            size_t newline;
+            while ((newline = m_Buffer.find('\n', m_Pos)) == std::string::npos) {
+                if (!fill()) {
+                    return false;
+                }
+            }
+            line.assign(m_Buffer, m_Pos, newline - m_Pos);
+            m_Pos = newline + 1;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            return true;
+        }
+
+        bool readBytes(std::string& out, size_t count)
+        {
+            while (m_Buffer.size() - m_Pos < count) {
+                if (!fill()) {
+                    return false;
+                }
+            }
+            out.assign(m_Buffer, m_Pos, count);
+            m_Pos += count;
+            return true;
+        }
+
+        bool write(const void* data, size_t size)
+        {
+            const char* bytes = static_cast<const char*>(data);
+            while (size > 0) {
+                ssize_t sent = ::send(m_Fd, bytes, size, 0);
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (sent <= 0) {
+                    return false;
+                }
+                bytes += sent;
+                size -= static_cast<size_t>(sent);
+            }
+            return true;
+        }
+
+        bool writeLine(const std::string& line)
+        {
+            const std::string text = line + "\n";
+            return write(text.data(), text.size());
+        }
+
+      private:
+        bool fill()
+        {
+            m_Buffer.erase(0, m_Pos);
+            m_Pos = 0;
+            char chunk[kReadChunk];
+            ssize_t received;
+            do {
+                received = ::recv(m_Fd, chunk, sizeof(chunk), 0);
+            } while (received < 0 && errno == EINTR);
+            if (received <= 0) {
+                return false;
+            }
+            m_Buffer.append(chunk, static_cast<size_t>(received));
+            return true;
+        }
+
+      private:
+        int m_Fd;
+        std::string m_Buffer;
+        size_t m_Pos{0};  // first unread byte of m_Buffer
+    };
+
+    // Settings collected for the next "render".
+    struct Job {
+        std::string scenePath;
+        std::string sceneText;
+        bool inlineScene{false};
+        int width{0};
+        int height{0};
+        std::string output;
+        int deadlineMs{0};
+        std::string error;  // answered instead of rendering
+    };
+
+    class Server {
+      public:
+        explicit Server(const RenderServerOptions& options)
+            : m_Options(options),
+              m_Pool(options.settings.threadCount > 0 ? static_cast<unsigned>(options.settings.threadCount) : 0u),
+              m_Cache(options.sceneCacheSize)
+        {
+            m_Cache.setDiskCache(options.diskCache);
+        }
+
+        int run();
+
+      private:
+        Job defaultJob() const;
+        void serve(int fd);
+        // Answers the job; false if the connection failed.
+        bool runJob(const Job& job, SocketStream& stream);
+
+      private:
+        RenderServerOptions m_Options;
+        ThreadPool m_Pool;
+        SceneCache m_Cache;
+        std::atomic<bool> m_Stop{false};
+        std::atomic<uint64_t> m_Jobs{0};
+        std::mutex m_Mutex;
+        std::condition_variable m_Idle;
+        std::set<int> m_Connections;  // open connection sockets
+    };
+
+    int Server::run()
+    {
+        const std::string& path = m_Options.socketPath;
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            std::cerr << "Socket path must be 1 to " << sizeof(address.sun_path) - 1 << " bytes: " << path
+                      << std::endl;
+            return 1;
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        // A socket left behind by a server that did not shut down cleanly is
+        // replaced; any other file is not touched.
+        struct stat st{};
+        if (stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            ::unlink(path.c_str());
+        }
+        int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0 || ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(listener, SOMAXCONN) != 0) {
+            std::cerr << "Cannot listen on " << path << ": " << std::strerror(errno) << std::endl;
+            if (listener >= 0) {
+                ::close(listener);
+            }
+            return 1;
+        }
+        // A client that hangs up early must not take the server down.
+        std::signal(SIGPIPE, SIG_IGN);
+        std::cout << "Serving on " << path << " (" << m_Pool.size() << " threads, up to "
+                  << m_Options.sceneCacheSize << " cached scenes)" << std::endl;
+
+        while (!m_Stop.load()) {
+            pollfd waiting{listener, POLLIN, 0};
+            if (::poll(&waiting, 1, kAcceptPollMs) <= 0) {
+                continue;
+            }
+            int fd = ::accept(listener, nullptr, nullptr);
+            if (fd < 0) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Connections.insert(fd);
+            std::thread(&Server::serve, this, fd).detach();
+        }
+        ::close(listener);
+        ::unlink(path.c_str());
+
+        // Idle connections are ended; a job being rendered is finished and answered.
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        for (int fd : m_Connections) {
+            ::shutdown(fd, SHUT_RD);
+        }
+        m_Idle.wait(lock, [&] { return m_Connections.empty(); });
+
+        const SceneCacheStats stats = m_Cache.stats();
+        std::cout << "Served " << m_Jobs.load() << " jobs; scene cache: " << stats.hits << " hits, " << stats.misses
+                  << " misses, " << stats.evictions << " evictions" << std::endl;
+        return 0;
+    }
+
+    Job Server::defaultJob() const
+    {
+        Job job;
+        job.width = m_Options.width;
+        job.height = m_Options.height;
+        job.deadlineMs = m_Options.deadlineMs;
+        return job;
+    }
+
+    void Server::serve(int fd)
+    {
+        SocketStream stream(fd);
+        Job job = defaultJob();
+        std::string line;
+        while (stream.readLine(line)) {
+            const size_t space = line.find(' ');
+            const std::string request = line.substr(0, space);
+            const std::string argument = space == std::string::npos ? std::string() : line.substr(space + 1);
+            if (request.empty()) {
+                continue;
+            }
+            if (request == "scene") {
+                job.scenePath = argument;
+                job.sceneText.clear();
+                job.inlineScene = false;
+            } else if (request == "scene-text") {
+                size_t size = 0;
+                try {
+                    size = std::stoull(argument);
+                } catch (const std::exception&) {
+                    size = kMaxInlineScene + 1;
+                }
+                // Without a valid size the rest of the stream cannot be read.
+                if (size > kMaxInlineScene) {
+                    stream.writeLine("error invalid scene-text size: " + argument);
+                    break;
+                }
+                if (!stream.readBytes(job.sceneText, size)) {
+                    break;
+                }
+                job.scenePath.clear();
+                job.inlineScene = true;
+            } else if (request == "resolution") {
+                if (!parseResolution(argument, job.width, job.height)) {
+                    job.error = "invalid resolution: " + argument;
+                } else if (static_cast<uint64_t>(job.width) * (job.height > 0 ? job.height : job.width) >
+                           kMaxJobPixels) {
+                    job.error = "resolution too large: " + argument + " (at most " +
+                                std::to_string(kMaxJobPixels) + " pixels)";
+                }
+            } else if (request == "output") {
+                job.output = argument;
+            } else if (request == "deadline") {
+                try {
+                    job.deadlineMs = std::stoi(argument);
+                } catch (const std::exception&) {
+                    job.deadlineMs = -1;
+                }
+                if (job.deadlineMs < 0) {
+                    job.error = "invalid deadline: " + argument;
+                }
+            } else if (request == "render") {
+                // A job that fails, say out of memory, is answered like any
+                // other error; the connection and the server carry on.
+                bool answered;
+                try {
+                    answered = runJob(job, stream);
+                } catch (const std::exception& e) {
+                    answered = stream.writeLine(std::string("error render failed: ") + e.what());
+                }
+                job = defaultJob();
+                if (!answered) {
+                    break;
+                }
+            } else if (request == "stats") {
+                const SceneCacheStats stats = m_Cache.stats();
+                std::ostringstream reply;
+                reply << "ok " << m_Jobs.load() << " " << stats.hits << " " << stats.misses << " " << stats.evictions
+                      << " " << stats.entries;
+                if (!stream.writeLine(reply.str())) {
+                    break;
+                }
+            } else if (request == "shutdown") {
+                m_Stop.store(true);
+                stream.writeLine("ok");
+                break;
+            } else {
+                job.error = "unknown request: " + request;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        ::close(fd);
+        m_Connections.erase(fd);
+        m_Idle.notify_all();
+    }
+
+    bool Server::runJob(const Job& job, SocketStream& stream)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        if (!job.error.empty()) {
+            return stream.writeLine("error " + job.error);
+        }
+        if (!job.inlineScene && job.scenePath.empty()) {
+            return stream.writeLine("error no scene given");
+        }
+        if (job.output.empty()) {
+            return stream.writeLine("error no output given");
+        }
+        // Binary scenes are only read from files the server can see, never from a client's bytes.
+        if (job.inlineScene && isSceneFile(job.sceneText.data(), job.sceneText.size())) {
+            return stream.writeLine("error scene-text takes scene text, not a binary scene file");
+        }
+
+        bool hit = false;
+        std::shared_ptr<const CompiledScene> scene =
+            job.inlineScene ? m_Cache.get(job.sceneText.data(), job.sceneText.size(), "<inline scene>", &hit)
+                            : m_Cache.getFile(job.scenePath, &hit);
+        if (!scene) {
+            return stream.writeLine("error cannot load scene " + (job.inlineScene ? "text" : job.scenePath));
+        }
+
+        RayTracer tracer(job.width, job.height > 0 ? job.height : job.width);
+        applyRenderSettings(m_Options.settings, tracer);
+        tracer.setThreadPool(&m_Pool);
+        tracer.setCompiledScene(std::move(scene));
+        std::vector<unsigned char> pixels;
+        float quality = 1.0f;
+        if (job.deadlineMs > 0) {
+            DeadlineRender result = tracer.render(start + std::chrono::milliseconds(job.deadlineMs));
+            pixels = std::move(result.pixels);
+            quality = result.quality;
+        } else {
+            pixels = tracer.render();
+        }
+
+        const bool sendPixels = job.output == "-";
+        if (!sendPixels && !tracer.writeImage(job.output, imageFormatForPath(job.output), pixels)) {
+            return stream.writeLine("error cannot write " + job.output);
+        }
+        ++m_Jobs;
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::ostringstream reply;
+        reply << "ok " << tracer.outputWidth() << " " << tracer.outputHeight() << " "
+              << (sendPixels ? pixels.size() : 0) << " " << std::fixed << std::setprecision(3) << ms << " "
+              << (hit ? "hit" : "miss");
+        if (job.deadlineMs > 0) {
+            reply << " " << quality;
+        }
+        return stream.writeLine(reply.str()) && (!sendPixels || stream.write(pixels.data(), pixels.size()));
+    }
+}
+
+int runRenderServer(const RenderServerOptions& options)
+{
+    Server server(options);
+    return server.run();
+}
+
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <RenderCli.h>
+
+#include <cstddef>
+#include <string>
+
+// Render daemon (bin/main --serve SOCKET): listens on a Unix socket and runs
+// render jobs on one persistent thread pool, with compiled scenes kept in a
+// SceneCache keyed by their content. Each connection is served on its own
+// thread, so jobs from several clients render at the same time and share
+// the pool's workers.
+//
+// The protocol is line based. A job is a run of setting lines ended by
+// "render"; settings left out take the server's defaults, and nothing carries
+// over to the next job on the connection:
+//
+//   scene PATH           scene file (text or binary), read by the server
+//   scene-text BYTES     inline scene: the next BYTES bytes are the scene
+//                        text (binary scenes are refused here)
+//   resolution W|WxH     output size (square when only W is given), at most
+//                        8192 x 8192 pixels
+//   output PATH|-        image file, format by extension as on the command
+//                        line; "-" sends the RGB8 pixels back instead
+//   deadline MS          time budget from the "render", scene load included
+//                        (see RayTracer::render(deadline)); 0 = none
+//   render               runs the job
+//
+// Every "render" is answered with one line, followed by the pixels for "-":
+//
+//   ok WIDTH HEIGHT BYTES MILLISECONDS hit|miss [QUALITY]   (BYTES = 0 for a
+//                        file; QUALITY, the estimate from 0 to 1, with a deadline)
+//   error MESSAGE
+//
+// "stats" answers "ok JOBS HITS MISSES EVICTIONS ENTRIES" (scene cache
+// counters); "shutdown" answers "ok" and stops the server once every open
+// connection is done.
+struct RenderServerOptions {
+    std::string socketPath;
+    size_t sceneCacheSize{16};  // compiled scenes kept
+    RenderSettings settings{};  // of every job; threadCount sizes the pool
+    std::shared_ptr<SceneDiskCache> diskCache;  // behind the in-memory cache; may be null
+    int width{1000};            // default job resolution
+    int height{0};              // 0 = square
+    int deadlineMs{0};          // default job deadline; 0 = none
+};
+
+// Serves until a "shutdown" request; returns the process exit code.
+int runRenderServer(const RenderServerOptions& options);
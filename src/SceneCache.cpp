@@ -0,0 +1,71 @@
+#include <SceneCache.h>
+#include <Hash.h>
+#include <MappedFile.h>
+#include <RayTracer.h>
+
+#include <iostream>
+
+std::shared_ptr<const CompiledScene> SceneCache::get(const char* data, size_t size, const std::string& name,
+                                                     bool* hit)
+{
+    // The size goes into the seed, so equal hashes also need equal lengths.
+    const uint64_t key = hashBytes(data, size, size);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto found = m_Index.find(key);
+        if (found != m_Index.end()) {
+            m_Entries.splice(m_Entries.begin(), m_Entries, found->second);
+            ++m_Stats.hits;
+            if (hit) {
+                *hit = true;
+            }
+            return found->second->second;
+        }
+        ++m_Stats.misses;
+    }
+    if (hit) {
+        *hit = false;
+    }
+
+    // Loaded without the lock, so other scenes stay available meanwhile. The
+    // loader's resolution plays no part in loading.
+    RayTracer loader(1, 1);
+    loader.setSceneDiskCache(m_DiskCache);
+    if (!loader.loadSceneFromMemory(data, size, name)) {
+        return nullptr;
+    }
+    std::shared_ptr<const CompiledScene> scene = loader.compiledScene();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto found = m_Index.find(key);
+    if (found != m_Index.end()) {
+        // Loaded by another thread at the same time: keep the first copy.
+        return found->second->second;
+    }
+    m_Entries.emplace_front(key, scene);
+    m_Index[key] = m_Entries.begin();
+    while (m_Entries.size() > m_Capacity) {
+        m_Index.erase(m_Entries.back().first);
+        m_Entries.pop_back();
+        ++m_Stats.evictions;
+    }
+    return scene;
+}
+
+std::shared_ptr<const CompiledScene> SceneCache::getFile(const std::string& path, bool* hit)
+{
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Failed to open scene file: " << path << std::endl;
+        return nullptr;
+    }
+    return get(file.data(), file.size(), path, hit);
+}
+
+SceneCacheStats SceneCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    SceneCacheStats stats = m_Stats;
+    stats.entries = m_Entries.size();
+    return stats;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <CompiledScene.h>
+#include <SceneDiskCache.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+struct SceneCacheStats {
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t evictions{0};
+    size_t entries{0};
+};
+
+// Compiled scenes by a hash of their source bytes (scene text or a binary
+// scene file), so an unchanged scene is parsed and its BVH built only once
+// however it reaches the process. The least recently used scene is dropped
+// once more than capacity are held; tracers still rendering it keep it alive
+// through their shared_ptr. Safe to use from several threads.
+class SceneCache {
+  public:
+    explicit SceneCache(size_t capacity) : m_Capacity(capacity > 0 ? capacity : 1) {}
+
+    SceneCache(const SceneCache&) = delete;
+    SceneCache& operator=(const SceneCache&) = delete;
+
+    // The compiled scene for data, loading and caching it on a miss; nullptr
+    // if it does not load. name is used in messages. hit, when given, tells
+    // whether the scene came from the cache.
+    std::shared_ptr<const CompiledScene> get(const char* data, size_t size, const std::string& name,
+                                             bool* hit = nullptr);
+    // The same for a file, keyed by its contents, not its path.
+    std::shared_ptr<const CompiledScene> getFile(const std::string& path, bool* hit = nullptr);
+
+    SceneCacheStats stats() const;
+    // Misses are looked up in, and added to, cache as well; nullptr turns it off.
+    void setDiskCache(std::shared_ptr<SceneDiskCache> cache) { m_DiskCache = std::move(cache); }
+
+  private:
+    using Entry = std::pair<uint64_t, std::shared_ptr<const CompiledScene>>;
+
+  private:
+    size_t m_Capacity;
+    std::shared_ptr<SceneDiskCache> m_DiskCache;
+    mutable std::mutex m_Mutex;
+    std::list<Entry> m_Entries;  // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_Index;
+    SceneCacheStats m_Stats{};
+};
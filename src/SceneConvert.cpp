@@ -0,0 +1,58 @@
+// Converts a text scene into the binary compiled-scene format (SceneFile.h),
+// which bin/main renders from a read-only mapping with no parsing.
+//
+//   scene_convert [--no-bvh] <scene.txt> <scene.rtscene>
+
+#include <CompiledScene.h>
+#include <MappedFile.h>
+#include <RayTracer.h>
+#include <SceneParser.h>
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+    bool withBvh = true;
+    std::string inputPath;
+    std::string outputPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--no-bvh") {
+            withBvh = false;
+        } else if (inputPath.empty()) {
+            inputPath = arg;
+        } else if (outputPath.empty()) {
+            outputPath = arg;
+        } else {
+            inputPath.clear();
+            break;
+        }
+    }
+    if (inputPath.empty() || outputPath.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--no-bvh] <scene.txt> <scene.rtscene>" << std::endl;
+        return 1;
+    }
+
+    MappedFile file;
+    if (!file.open(inputPath)) {
+        std::cerr << "Failed to open scene file: " << inputPath << std::endl;
+        return 1;
+    }
+    Scene scene;
+    if (!parseSceneText(file.data(), file.size(), inputPath, scene)) {
+        return 1;
+    }
+
+    auto compiled = CompiledScene::compile(scene);
+    if (!compiled->writeBinary(outputPath, withBvh)) {
+        return 1;
+    }
+
+    const GeometryView& geometry = compiled->geometryView();
+    std::cout << "Wrote " << outputPath << ": " << geometry.sphereCount << " spheres, " << geometry.planeCount
+              << " planes, " << geometry.materialCount << " materials, " << compiled->lightView().count
+              << " lights, " << (withBvh ? std::to_string(geometry.nodeCount) + " BVH nodes" : "no BVH")
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include <SceneDiskCache.h>
+#include <Bvh.h>
+#include <Hash.h>
+#include <SceneFile.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Bump whenever compiling the same scene text gives a different result
+    // (parser, flattening or BVH builder changes), so stale entries miss.
+    constexpr uint32_t kSceneCompilerVersion = 1;
+    constexpr const char* kEntryExtension = ".rtscene";
+}
+
+SceneDiskCache::SceneDiskCache(const std::string& directory, uint64_t maxBytes)
+    : m_Directory(directory), m_MaxBytes(maxBytes)
+{
+    std::error_code error;
+    fs::create_directories(m_Directory, error);
+    if (error) {
+        std::cerr << "Cannot create scene cache directory " << m_Directory << ": " << error.message() << std::endl;
+    }
+}
+
+uint64_t SceneDiskCache::key(const char* data, size_t size)
+{
+    const uint32_t build[6] = {kSceneCompilerVersion, kSceneFileVersion, kSceneFileByteOrder,
+                               static_cast<uint32_t>(sizeof(Material)), static_cast<uint32_t>(sizeof(BvhNode)),
+                               static_cast<uint32_t>(size)};
+    return hashBytes(data, size, hashBytes(build, sizeof(build)));
+}
+
+std::string SceneDiskCache::entryPath(uint64_t key) const
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return (fs::path(m_Directory) / (std::string(name) + kEntryExtension)).string();
+}
+
+std::shared_ptr<const CompiledScene> SceneDiskCache::load(uint64_t key, const std::string& name)
+{
+    const std::string path = entryPath(key);
+    std::error_code error;
+    std::shared_ptr<const CompiledScene> scene;
+    if (fs::exists(path, error)) {
+        scene = CompiledScene::loadBinary(path);
+        if (scene) {
+            // Recently used entries are the last to be evicted.
+            fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+        } else {
+            std::cerr << "Dropping unreadable scene cache entry for " << name << std::endl;
+            fs::remove(path, error);
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    ++(scene ? m_Stats.hits : m_Stats.misses);
+    return scene;
+}
+
+void SceneDiskCache::store(uint64_t key, const CompiledScene& scene)
+{
+    const std::string path = entryPath(key);
+    const std::string temporary = path + ".tmp" + std::to_string(std::random_device{}());
+    std::error_code error;
+    if (!scene.writeBinary(temporary, true)) {
+        fs::remove(temporary, error);
+        return;
+    }
+    if (fs::file_size(temporary, error) > m_MaxBytes) {
+        fs::remove(temporary, error);
+        return;
+    }
+    fs::rename(temporary, path, error);
+    if (error) {
+        std::cerr << "Cannot add " << path << " to the scene cache: " << error.message() << std::endl;
+        fs::remove(temporary, error);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        ++m_Stats.stores;
+    }
+    evict(path);
+}
+
+void SceneDiskCache::evict(const std::string& keep)
+{
+    struct Entry {
+        fs::file_time_type used;
+        uint64_t bytes;
+        fs::path path;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code error;
+    for (fs::directory_iterator it(m_Directory, error), end; !error && it != end; it.increment(error)) {
+        if (it->path().extension() != kEntryExtension) {
+            continue;
+        }
+        std::error_code entryError;
+        Entry entry{fs::last_write_time(it->path(), entryError), fs::file_size(it->path(), entryError), it->path()};
+        if (!entryError) {
+            total += entry.bytes;
+            entries.push_back(entry);
+        }
+    }
+    if (total <= m_MaxBytes) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    uint64_t evicted = 0;
+    for (const Entry& entry : entries) {
+        if (total <= m_MaxBytes) {
+            break;
+        }
+        // Processes that still map a deleted entry keep their view of it.
+        if (entry.path.string() != keep && fs::remove(entry.path, error)) {
+            total -= entry.bytes;
+            ++evicted;
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stats.evictions += evicted;
+}
+
+SceneDiskCacheStats SceneDiskCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+uint64_t SceneDiskCache::sizeBytes() const
+{
+    uint64_t total = 0;
+    std::error_code error;
+    for (fs::directory_iterator it(m_Directory, error), end; !error && it != end; it.increment(error)) {
+        std::error_code entryError;
+        const uint64_t bytes = it->path().extension() == kEntryExtension ? fs::file_size(it->path(), entryError) : 0;
+        total += entryError ? 0 : bytes;
+    }
+    return total;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <CompiledScene.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+struct SceneDiskCacheStats {
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t stores{0};
+    uint64_t evictions{0};
+};
+
+// Content-addressed directory of compiled scenes. Each entry is a binary
+// scene file with its BVH (see SceneFile.h), named after a hash of the scene
+// text and of everything that decides what compiling it produces, so a hit
+// is mapped and rendered in place with no parsing and no BVH build, and an
+// edited scene or a different build simply misses. Once the entries exceed
+// maxBytes, the least recently used ones are deleted. Entries are written
+// under a temporary name and renamed, so processes may share a directory.
+class SceneDiskCache {
+  public:
+    SceneDiskCache(const std::string& directory, uint64_t maxBytes);
+
+    SceneDiskCache(const SceneDiskCache&) = delete;
+    SceneDiskCache& operator=(const SceneDiskCache&) = delete;
+
+    static uint64_t key(const char* data, size_t size);
+
+    // The cached scene for key, or nullptr on a miss.
+    std::shared_ptr<const CompiledScene> load(uint64_t key, const std::string& name);
+    // Adds scene under key and evicts down to the size cap. Failures are
+    // reported but not fatal: the scene is simply compiled again next time.
+    void store(uint64_t key, const CompiledScene& scene);
+
+    SceneDiskCacheStats stats() const;
+    // Bytes currently held by entries in the directory.
+    uint64_t sizeBytes() const;
+    const std::string& directory() const { return m_Directory; }
+    uint64_t maxBytes() const { return m_MaxBytes; }
+
+  private:
+    std::string entryPath(uint64_t key) const;
+    void evict(const std::string& keep);
+
+  private:
+    std::string m_Directory;
+    uint64_t m_MaxBytes;
+    mutable std::mutex m_Mutex;
+    SceneDiskCacheStats m_Stats{};
+};
@@ -0,0 +1,305 @@
+#include <SceneFile.h>
+#include <CompiledScene.h>
+#include <Hash.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+static_assert(std::is_trivially_copyable_v<Material>, "materials are stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<BvhNode>, "BVH nodes are stored as raw bytes");
+static_assert(sizeof(SceneFileHeader) % 8 == 0, "section offsets must stay 8-byte aligned");
+
+namespace {
+    uint64_t alignUp(uint64_t offset)
+    {
+        return (offset + kSceneSectionAlignment - 1) / kSceneSectionAlignment * kSceneSectionAlignment;
+    }
+
+    // Visits every array of the views with its section id and element count.
+    // Writing and loading both go through here, so the two can never disagree
+    // about the order or the size of the sections.
+    template <typename Geometry, typename Lights, typename Fn>
+    void forEachSection(Geometry& g, Lights& l, Fn&& fn)
+    {
+        fn(SceneSection::SphereX, g.sphereX, g.sphereCount);
+        fn(SceneSection::SphereY, g.sphereY, g.sphereCount);
+        fn(SceneSection::SphereZ, g.sphereZ, g.sphereCount);
+        fn(SceneSection::SphereRadiusSq, g.sphereRadiusSq, g.sphereCount);
+        fn(SceneSection::SphereMaterial, g.sphereMaterial, g.sphereCount);
+        fn(SceneSection::SphereOrder, g.sphereOrder, g.sphereCount);
+        fn(SceneSection::PlaneX, g.planeX, g.planeCount);
+        fn(SceneSection::PlaneY, g.planeY, g.planeCount);
+        fn(SceneSection::PlaneZ, g.planeZ, g.planeCount);
+        fn(SceneSection::PlaneD, g.planeD, g.planeCount);
+        fn(SceneSection::PlaneMaterial, g.planeMaterial, g.planeCount);
+        fn(SceneSection::PlaneOrder, g.planeOrder, g.planeCount);
+        fn(SceneSection::Materials, g.materials, g.materialCount);
+        fn(SceneSection::LightDirX, l.dirX, l.count);
+        fn(SceneSection::LightDirY, l.dirY, l.count);
+        fn(SceneSection::LightDirZ, l.dirZ, l.count);
+        fn(SceneSection::LightPosX, l.posX, l.count);
+        fn(SceneSection::LightPosY, l.posY, l.count);
+        fn(SceneSection::LightPosZ, l.posZ, l.count);
+        fn(SceneSection::LightIntensityR, l.intensityR, l.count);
+        fn(SceneSection::LightIntensityG, l.intensityG, l.count);
+        fn(SceneSection::LightIntensityB, l.intensityB, l.count);
+        fn(SceneSection::LightCutoff, l.cutoff, l.count);
+        fn(SceneSection::LightIsSpot, l.isSpot, l.count);
+        fn(SceneSection::BvhNodes, g.nodes, g.nodeCount);
+        fn(SceneSection::BvhPrimIndices, g.primIndices, g.primIndexCount);
+    }
+
+    template <typename Pointer>
+    uint64_t sectionBytes(Pointer, uint32_t count)
+    {
+        return static_cast<uint64_t>(count) * sizeof(std::remove_pointer_t<Pointer>);
+    }
+
+    void packCamera(const CameraParams& cam, float out[12])
+    {
+        const float values[12] = {cam.eye.x, cam.eye.y, cam.eye.z, cam.up.x, cam.up.y, cam.up.z,
+                                  cam.forward.x, cam.forward.y, cam.forward.z,
+                                  cam.screenDistance, cam.screenWidth, cam.screenHeight};
+        std::memcpy(out, values, sizeof(values));
+    }
+
+    CameraParams unpackCamera(const float in[12])
+    {
+        CameraParams cam;
+        cam.eye = {in[0], in[1], in[2]};
+        cam.up = {in[3], in[4], in[5]};
+        cam.forward = {in[6], in[7], in[8]};
+        cam.screenDistance = in[9];
+        cam.screenWidth = in[10];
+        cam.screenHeight = in[11];
+        return cam;
+    }
+
+    // Checks every index the renderer follows without bounds checks: the
+    // material of each primitive and, when the file has one, the BVH. The
+    // BVH must be a tree rooted at node 0 (each node reached once), no
+    // deeper than the kernels' traversal stacks allow, with leaf ranges in
+    // the index list and sphere indices in the sphere arrays. Returns the
+    // first problem found, or an empty string.
+    std::string checkIndices(const GeometryView& g, bool checkBvh)
+    {
+        for (uint32_t i = 0; i < g.sphereCount; ++i) {
+            if (g.sphereMaterial[i] >= g.materialCount) {
+                return "sphere material index out of range";
+            }
+        }
+        for (uint32_t i = 0; i < g.planeCount; ++i) {
+            if (g.planeMaterial[i] >= g.materialCount) {
+                return "plane material index out of range";
+            }
+        }
+        if (!checkBvh || g.nodeCount == 0) {
+            return {};
+        }
+        for (uint32_t i = 0; i < g.primIndexCount; ++i) {
+            if (g.primIndices[i] >= g.sphereCount) {
+                return "BVH primitive index out of range";
+            }
+        }
+        struct Pending {
+            uint32_t node;
+            int depth;
+        };
+        std::vector<uint8_t> reached(g.nodeCount, 0);
+        std::vector<Pending> work{{0, 0}};
+        reached[0] = 1;
+        while (!work.empty()) {
+            const Pending item = work.back();
+            work.pop_back();
+            const BvhNode& node = g.nodes[item.node];
+            if (node.isLeaf()) {
+                if (static_cast<uint64_t>(node.leftOrFirst) + node.primCount > g.primIndexCount) {
+                    return "BVH leaf range out of range";
+                }
+                continue;
+            }
+            if (item.depth + 1 > Bvh::kMaxDepth - 2) {
+                return "BVH deeper than " + std::to_string(Bvh::kMaxDepth - 2) + " levels";
+            }
+            const uint64_t left = node.leftOrFirst;
+            if (left == 0 || left + 1 >= g.nodeCount) {
+                return "BVH child index out of range";
+            }
+            for (uint32_t child = node.leftOrFirst; child <= node.leftOrFirst + 1; ++child) {
+                if (reached[child]) {
+                    return "BVH node reached twice";
+                }
+                reached[child] = 1;
+                work.push_back({child, item.depth + 1});
+            }
+        }
+        return {};
+    }
+
+    std::shared_ptr<const CompiledScene> loadError(const std::string& path, const std::string& message)
+    {
+        std::cerr << path << ": " << message << std::endl;
+        return nullptr;
+    }
+}
+
+bool isSceneFile(const char* data, size_t size)
+{
+    return size >= sizeof(kSceneFileMagic) && std::memcmp(data, kSceneFileMagic, sizeof(kSceneFileMagic)) == 0;
+}
+
+std::shared_ptr<const CompiledScene> CompiledScene::loadBinary(const std::string& path)
+{
+    MappedFile file;
+    if (!file.open(path, MappedFile::Access::Random)) {
+        return loadError(path, "cannot open file");
+    }
+    return loadBinary(std::move(file), path);
+}
+
+std::shared_ptr<const CompiledScene> CompiledScene::loadBinary(MappedFile file, const std::string& path)
+{
+    const char* data = file.data();
+    const size_t size = file.size();
+    if (!isSceneFile(data, size) || size < sizeof(SceneFileHeader)) {
+        return loadError(path, "not a binary scene file");
+    }
+    SceneFileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.version != kSceneFileVersion) {
+        return loadError(path, "unsupported scene file version " + std::to_string(header.version) +
+                                   " (expected " + std::to_string(kSceneFileVersion) + ")");
+    }
+    if (header.byteOrder != kSceneFileByteOrder || header.materialSize != sizeof(Material) ||
+        header.nodeSize != sizeof(BvhNode) || header.sectionCount != kSceneSectionCount) {
+        return loadError(path, "scene file was written for a different platform; convert it again");
+    }
+    const bool hasBvh = (header.flags & kSceneFileHasBvh) != 0;
+    if (!hasBvh && (header.nodeCount != 0 || header.primIndexCount != 0)) {
+        return loadError(path, "corrupt scene file (BVH data without the BVH flag)");
+    }
+
+    std::shared_ptr<CompiledScene> compiled(new CompiledScene());
+    GeometryView& g = compiled->m_GeometryView;
+    LightView& l = compiled->m_LightView;
+    g.sphereCount = header.sphereCount;
+    g.planeCount = header.planeCount;
+    g.materialCount = header.materialCount;
+    g.nodeCount = header.nodeCount;
+    g.primIndexCount = header.primIndexCount;
+    l.count = header.lightCount;
+
+    // Sections are used in place: a range check per section, then one pass
+    // over the index sections, is the whole "parse".
+    bool inBounds = true;
+    forEachSection(g, l, [&](SceneSection section, auto& pointer, uint32_t count) {
+        using Pointer = std::remove_reference_t<decltype(pointer)>;
+        const uint64_t offset = header.sectionOffset[static_cast<size_t>(section)];
+        const uint64_t bytes = sectionBytes(pointer, count);
+        if (offset % kSceneSectionAlignment != 0 || offset > size || bytes > size - offset) {
+            inBounds = false;
+            return;
+        }
+        pointer = reinterpret_cast<Pointer>(data + offset);
+    });
+    if (!inBounds) {
+        return loadError(path, "corrupt scene file (section out of bounds)");
+    }
+    const std::string problem = checkIndices(g, hasBvh);
+    if (!problem.empty()) {
+        return loadError(path, "corrupt scene file (" + problem + ")");
+    }
+
+    if (!hasBvh) {
+        buildSphereBvh(g, compiled->m_FileBvh);
+        g.nodes = compiled->m_FileBvh.nodes().data();
+        g.primIndices = compiled->m_FileBvh.primIndices().data();
+        g.nodeCount = static_cast<uint32_t>(compiled->m_FileBvh.nodes().size());
+        g.primIndexCount = static_cast<uint32_t>(compiled->m_FileBvh.primIndices().size());
+    }
+
+    compiled->m_CameraParams = unpackCamera(header.camera);
+    compiled->m_Ambient = {header.ambient[0], header.ambient[1], header.ambient[2]};
+    compiled->m_File = std::move(file);  // the views keep pointing at the same mapping
+    return compiled;
+}
+
+uint64_t CompiledScene::fingerprint() const
+{
+    uint64_t hash = 0;
+    forEachSection(m_GeometryView, m_LightView, [&](SceneSection section, const auto& pointer, uint32_t count) {
+        if (section == SceneSection::BvhNodes || section == SceneSection::BvhPrimIndices) {
+            return;
+        }
+        hash = hashBytes(&count, sizeof(count), hash);
+        hash = hashBytes(pointer, sectionBytes(pointer, count), hash);
+    });
+    float camera[12];
+    packCamera(m_CameraParams, camera);
+    hash = hashBytes(camera, sizeof(camera), hash);
+    const float ambient[3] = {m_Ambient.x, m_Ambient.y, m_Ambient.z};
+    return hashBytes(ambient, sizeof(ambient), hash);
+}
+
+bool CompiledScene::writeBinary(const std::string& path, bool withBvh) const
+{
+    GeometryView g = m_GeometryView;
+    if (!withBvh) {
+        g.nodes = nullptr;
+        g.primIndices = nullptr;
+        g.nodeCount = 0;
+        g.primIndexCount = 0;
+    }
+
+    SceneFileHeader header{};
+    std::memcpy(header.magic, kSceneFileMagic, sizeof(kSceneFileMagic));
+    header.version = kSceneFileVersion;
+    header.flags = withBvh ? kSceneFileHasBvh : 0;
+    header.byteOrder = kSceneFileByteOrder;
+    header.materialSize = sizeof(Material);
+    header.nodeSize = sizeof(BvhNode);
+    header.sphereCount = g.sphereCount;
+    header.planeCount = g.planeCount;
+    header.materialCount = g.materialCount;
+    header.lightCount = m_LightView.count;
+    header.nodeCount = g.nodeCount;
+    header.primIndexCount = g.primIndexCount;
+    header.sectionCount = kSceneSectionCount;
+    packCamera(m_CameraParams, header.camera);
+    header.ambient[0] = m_Ambient.x;
+    header.ambient[1] = m_Ambient.y;
+    header.ambient[2] = m_Ambient.z;
+
+    uint64_t offset = alignUp(sizeof(header));
+    forEachSection(g, m_LightView, [&](SceneSection section, const auto& pointer, uint32_t count) {
+        header.sectionOffset[static_cast<size_t>(section)] = offset;
+        offset = alignUp(offset + sectionBytes(pointer, count));
+    });
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    const char padding[kSceneSectionAlignment] = {};
+    forEachSection(g, m_LightView, [&](SceneSection section, const auto& pointer, uint32_t count) {
+        const uint64_t start = header.sectionOffset[static_cast<size_t>(section)];
+        out.write(padding, static_cast<std::streamsize>(start - written));
+        const uint64_t bytes = sectionBytes(pointer, count);
+        if (bytes > 0) {
+            out.write(reinterpret_cast<const char*>(pointer), static_cast<std::streamsize>(bytes));
+        }
+        written = start + bytes;
+    });
+    if (!out.good()) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
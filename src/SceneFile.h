@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Binary compiled-scene format, written by CompiledScene::writeBinary (see the
+// scene_convert tool) and rendered from in place by CompiledScene::loadBinary.
+//
+// The file is the header below followed by one section per array of the
+// compiled scene, each starting on a kSceneSectionAlignment boundary. Arrays
+// are stored exactly as GeometryView / LightView expose them, in the byte
+// order of the machine that wrote the file; a reader with a different byte
+// order or a different Material / BvhNode layout rejects the file instead of
+// converting it. Bump kSceneFileVersion on any change to this layout.
+
+constexpr char kSceneFileMagic[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+constexpr uint32_t kSceneFileVersion = 1;
+constexpr uint32_t kSceneFileByteOrder = 0x01020304;
+constexpr uint64_t kSceneSectionAlignment = 64;
+
+enum SceneFileFlags : uint32_t {
+    kSceneFileHasBvh = 1u << 0,
+};
+
+enum class SceneSection : uint32_t {
+    SphereX,
+    SphereY,
+    SphereZ,
+    SphereRadiusSq,
+    SphereMaterial,
+    SphereOrder,
+    PlaneX,
+    PlaneY,
+    PlaneZ,
+    PlaneD,
+    PlaneMaterial,
+    PlaneOrder,
+    Materials,
+    LightDirX,
+    LightDirY,
+    LightDirZ,
+    LightPosX,
+    LightPosY,
+    LightPosZ,
+    LightIntensityR,
+    LightIntensityG,
+    LightIntensityB,
+    LightCutoff,
+    LightIsSpot,
+    BvhNodes,
+    BvhPrimIndices,
+    Count
+};
+
+constexpr size_t kSceneSectionCount = static_cast<size_t>(SceneSection::Count);
+
+struct SceneFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t byteOrder;     // kSceneFileByteOrder as the writer stored it
+    uint32_t materialSize;  // sizeof(Material) of the writer
+    uint32_t nodeSize;      // sizeof(BvhNode) of the writer
+    uint32_t sphereCount;
+    uint32_t planeCount;
+    uint32_t materialCount;
+    uint32_t lightCount;
+    uint32_t nodeCount;
+    uint32_t primIndexCount;
+    uint32_t sectionCount;
+    float camera[12];  // eye, up, forward, screen distance / width / height
+    float ambient[3];
+    uint32_t reserved;
+    uint64_t sectionOffset[kSceneSectionCount];  // from the start of the file
+};
+
+// True when [data, data + size) starts like a binary scene file, whatever its
+// version; loadBinary does the full validation.
+bool isSceneFile(const char* data, size_t size);
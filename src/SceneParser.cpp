@@ -0,0 +1,197 @@
+#include <SceneParser.h>
+#include <RayTracer.h>
+
+#include <charconv>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace {
+    // Whitespace-separated tokens, like reading the file with operator>>:
+    // values may continue on the next line, and lines are counted on the way.
+    class TokenReader {
+      public:
+        TokenReader(const char* data, size_t size, const std::string& name)
+            : m_Cur(data), m_End(data + size), m_Name(name)
+        {}
+
+        bool next(std::string_view& token)
+        {
+            skipSpace();
+            if (m_Cur == m_End) {
+                return false;
+            }
+            const char* start = m_Cur;
+            while (m_Cur != m_End && !isSpace(*m_Cur)) {
+                ++m_Cur;
+            }
+            token = std::string_view(start, static_cast<size_t>(m_Cur - start));
+            m_TokenLine = m_Line;
+            return true;
+        }
+
+        bool readFloat(float& value)
+        {
+            std::string_view token;
+            if (!next(token)) {
+                return error("unexpected end of file, expected a number");
+            }
+            const char* first = token.data();
+            const char* last = first + token.size();
+            if (first != last && *first == '+') {
+                ++first;  // operator>> accepts an explicit plus sign, from_chars does not
+            }
+            auto result = std::from_chars(first, last, value);
+            if (result.ec != std::errc() || result.ptr != last) {
+                return error("invalid number '" + std::string(token) + "'");
+            }
+            return true;
+        }
+
+        template <typename... Floats>
+        bool readFloats(Floats&... values)
+        {
+            return (readFloat(values) && ...);
+        }
+
+        void skipLine()
+        {
+            while (m_Cur != m_End && *m_Cur != '\n') {
+                ++m_Cur;
+            }
+        }
+
+        bool error(const std::string& message) const
+        {
+            std::cerr << m_Name << ":" << m_TokenLine << ": " << message << std::endl;
+            return false;
+        }
+
+      private:
+        static bool isSpace(char c)
+        {
+            return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+        }
+
+        void skipSpace()
+        {
+            while (m_Cur != m_End && isSpace(*m_Cur)) {
+                if (*m_Cur == '\n') {
+                    ++m_Line;
+                }
+                ++m_Cur;
+            }
+        }
+
+        const char* m_Cur;
+        const char* m_End;
+        const std::string& m_Name;
+        int m_Line{1};
+        int m_TokenLine{1};
+    };
+}
+
+bool parseSceneText(const char* data, size_t size, const std::string& name, Scene& scene)
+{
+    TokenReader reader(data, size, name);
+
+    // Colors bind to objects, and positions and intensities to lights, in the
+    // order both appear. Each binding is a cursor into a FIFO, so the whole
+    // parse stays linear in the file size.
+    size_t nextColor = 0;
+    std::vector<size_t> spotOrder;  // lights that expect a 'p' line
+    size_t nextPosition = 0;
+    size_t nextIntensity = 0;
+
+    std::string_view tag;
+    while (reader.next(tag)) {
+        if (tag == "e") {
+            CameraParams& cam = scene.camera;
+            if (!reader.readFloats(cam.eye.x, cam.eye.y, cam.eye.z, cam.screenDistance)) {
+                return false;
+            }
+        } else if (tag == "u") {
+            CameraParams& cam = scene.camera;
+            if (!reader.readFloats(cam.up.x, cam.up.y, cam.up.z, cam.screenHeight)) {
+                return false;
+            }
+        } else if (tag == "f") {
+            CameraParams& cam = scene.camera;
+            if (!reader.readFloats(cam.forward.x, cam.forward.y, cam.forward.z, cam.screenWidth)) {
+                return false;
+            }
+        } else if (tag == "a") {
+            float ignore = 0.0f;
+            if (!reader.readFloats(scene.ambient.r, scene.ambient.g, scene.ambient.b, ignore)) {
+                return false;
+            }
+        } else if (tag == "d") {
+            Light l{};
+            float typeFlag = 0.0f;
+            if (!reader.readFloats(l.direction.x, l.direction.y, l.direction.z, typeFlag)) {
+                return false;
+            }
+            l.direction = glm::normalize(l.direction);
+            l.isSpot = typeFlag > 0.5f;
+            l.cutoff = 0.0f;
+            if (l.isSpot) {
+                spotOrder.push_back(scene.lights.size());
+            }
+            scene.lights.push_back(l);
+        } else if (tag == "p") {
+            glm::vec3 pos;
+            float cutoff = 0.0f;
+            if (!reader.readFloats(pos.x, pos.y, pos.z, cutoff)) {
+                return false;
+            }
+            if (nextPosition < spotOrder.size()) {
+                Light& light = scene.lights[spotOrder[nextPosition++]];
+                light.position = pos;
+                light.cutoff = cutoff;
+            }
+        } else if (tag == "i") {
+            glm::vec3 intensity;
+            float ignore = 0.0f;
+            if (!reader.readFloats(intensity.r, intensity.g, intensity.b, ignore)) {
+                return false;
+            }
+            if (nextIntensity < scene.lights.size()) {
+                scene.lights[nextIntensity++].intensity = intensity;
+            }
+        } else if (tag == "o" || tag == "r" || tag == "t") {
+            float a = 0.0f;
+            float b = 0.0f;
+            float c = 0.0f;
+            float d = 0.0f;
+            if (!reader.readFloats(a, b, c, d)) {
+                return false;
+            }
+            Material mat{};
+            mat.type = tag == "r" ? ObjectType::Reflective : tag == "t" ? ObjectType::Transparent : ObjectType::Opaque;
+            // Reflective and transparent objects ignore ambient/diffuse
+            bool isSphere = d > 0.0f;
+            if (isSphere) {
+                scene.objects.push_back(std::make_unique<Sphere>(glm::vec3(a, b, c), d, mat));
+            } else {
+                scene.objects.push_back(std::make_unique<Plane>(glm::vec3(a, b, c), d, mat));
+            }
+        } else if (tag == "c") {
+            glm::vec3 color;
+            float shininess = 1.0f;
+            if (!reader.readFloats(color.r, color.g, color.b, shininess)) {
+                return false;
+            }
+            if (nextColor < scene.objects.size()) {
+                Object* obj = scene.objects[nextColor++].get();
+                Material mat = obj->material();
+                mat.ambient = color;
+                mat.diffuse = color;
+                mat.shininess = shininess;
+                obj->setMaterial(mat);
+            }
+        } else {
+            reader.skipLine();  // unknown tag
+        }
+    }
+    return true;
+}
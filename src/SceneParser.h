@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+struct Scene;
+
+// Parses the text scene format in one linear pass over [data, data + size).
+// Problems are reported on std::cerr as "<name>:<line>: <message>" and make
+// the call return false; scene is then left partially filled.
+bool parseSceneText(const char* data, size_t size, const std::string& name, Scene& scene);
@@ -0,0 +1,46 @@
+// 8-wide AVX2 traits for PacketKernels.inl.
+
+#include <immintrin.h>
+
+namespace {
+    struct SimdAvx2 {
+        using F = __m256;
+        using I = __m256i;
+
+        RT_KERNEL_TARGET static F set1(float v) { return _mm256_set1_ps(v); }
+        RT_KERNEL_TARGET static F load(const float* p) { return _mm256_load_ps(p); }
+        RT_KERNEL_TARGET static void store(float* p, F v) { _mm256_store_ps(p, v); }
+        RT_KERNEL_TARGET static I set1i(int32_t v) { return _mm256_set1_epi32(v); }
+        RT_KERNEL_TARGET static void storei(int32_t* p, I v) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+
+        RT_KERNEL_TARGET static F add(F a, F b) { return _mm256_add_ps(a, b); }
+        RT_KERNEL_TARGET static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+        RT_KERNEL_TARGET static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+        RT_KERNEL_TARGET static F div(F a, F b) { return _mm256_div_ps(a, b); }
+        RT_KERNEL_TARGET static F sqrt(F a) { return _mm256_sqrt_ps(a); }
+        RT_KERNEL_TARGET static F neg(F a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+        RT_KERNEL_TARGET static F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+
+        RT_KERNEL_TARGET static F lessMask(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        RT_KERNEL_TARGET static F greaterMask(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        RT_KERNEL_TARGET static F notLessMask(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_NLT_UQ); }
+        RT_KERNEL_TARGET static F greaterMaskI(I a, I b) { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(a, b)); }
+        RT_KERNEL_TARGET static F andMask(F a, F b) { return _mm256_and_ps(a, b); }
+        RT_KERNEL_TARGET static F orMask(F a, F b) { return _mm256_or_ps(a, b); }
+        RT_KERNEL_TARGET static F notMask(F a) { return _mm256_xor_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+        RT_KERNEL_TARGET static int movemask(F m) { return _mm256_movemask_ps(m); }
+
+        // m ? b : a, lane by lane
+        RT_KERNEL_TARGET static F blend(F a, F b, F m) { return _mm256_blendv_ps(a, b, m); }
+        RT_KERNEL_TARGET static I blendi(I a, I b, F m)
+        {
+            return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), m));
+        }
+        RT_KERNEL_TARGET static F laneMask(uint32_t bits)
+        {
+            I lanes = _mm256_set_epi32(128, 64, 32, 16, 8, 4, 2, 1);
+            I set = _mm256_and_si256(_mm256_set1_epi32(static_cast<int32_t>(bits)), lanes);
+            return _mm256_castsi256_ps(_mm256_cmpeq_epi32(set, lanes));
+        }
+    };
+}  // namespace
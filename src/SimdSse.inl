@@ -0,0 +1,48 @@
+// 4-wide SSE traits for PacketKernels.inl. Only SSE2 instructions are used,
+// so the generic (baseline x86-64) variant can include this too.
+
+#include <emmintrin.h>
+
+namespace {
+    struct SimdSse {
+        using F = __m128;
+        using I = __m128i;
+
+        RT_KERNEL_TARGET static F set1(float v) { return _mm_set1_ps(v); }
+        RT_KERNEL_TARGET static F load(const float* p) { return _mm_load_ps(p); }
+        RT_KERNEL_TARGET static void store(float* p, F v) { _mm_store_ps(p, v); }
+        RT_KERNEL_TARGET static I set1i(int32_t v) { return _mm_set1_epi32(v); }
+        RT_KERNEL_TARGET static void storei(int32_t* p, I v) { _mm_store_si128(reinterpret_cast<__m128i*>(p), v); }
+
+        RT_KERNEL_TARGET static F add(F a, F b) { return _mm_add_ps(a, b); }
+        RT_KERNEL_TARGET static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+        RT_KERNEL_TARGET static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+        RT_KERNEL_TARGET static F div(F a, F b) { return _mm_div_ps(a, b); }
+        RT_KERNEL_TARGET static F sqrt(F a) { return _mm_sqrt_ps(a); }
+        RT_KERNEL_TARGET static F neg(F a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+        RT_KERNEL_TARGET static F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+        RT_KERNEL_TARGET static F lessMask(F a, F b) { return _mm_cmplt_ps(a, b); }
+        RT_KERNEL_TARGET static F greaterMask(F a, F b) { return _mm_cmpgt_ps(a, b); }
+        RT_KERNEL_TARGET static F notLessMask(F a, F b) { return _mm_cmpnlt_ps(a, b); }
+        RT_KERNEL_TARGET static F greaterMaskI(I a, I b) { return _mm_castsi128_ps(_mm_cmpgt_epi32(a, b)); }
+        RT_KERNEL_TARGET static F andMask(F a, F b) { return _mm_and_ps(a, b); }
+        RT_KERNEL_TARGET static F orMask(F a, F b) { return _mm_or_ps(a, b); }
+        RT_KERNEL_TARGET static F notMask(F a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+        RT_KERNEL_TARGET static int movemask(F m) { return _mm_movemask_ps(m); }
+
+        // m ? b : a, lane by lane
+        RT_KERNEL_TARGET static F blend(F a, F b, F m) { return _mm_or_ps(_mm_and_ps(m, b), _mm_andnot_ps(m, a)); }
+        RT_KERNEL_TARGET static I blendi(I a, I b, F m)
+        {
+            I mi = _mm_castps_si128(m);
+            return _mm_or_si128(_mm_and_si128(mi, b), _mm_andnot_si128(mi, a));
+        }
+        RT_KERNEL_TARGET static F laneMask(uint32_t bits)
+        {
+            I lanes = _mm_set_epi32(8, 4, 2, 1);
+            I set = _mm_and_si128(_mm_set1_epi32(static_cast<int32_t>(bits)), lanes);
+            return _mm_castsi128_ps(_mm_cmpeq_epi32(set, lanes));
+        }
+    };
+}  // namespace
@@ -0,0 +1,230 @@
+#include <ThreadPool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+namespace {
+    constexpr int kCancelPollMs = 1;  // how often a cancellable parallelFor looks at its flag
+
+    // Lets parallelFor detect that it is running on one of the pool's own
+    // workers, in which case it helps with the queued work instead of sleeping.
+    thread_local const ThreadPool* tl_Pool = nullptr;
+    thread_local unsigned tl_WorkerIndex = 0;
+}
+
+struct ThreadPool::Batch {
+    const std::function<void(size_t)>* fn{nullptr};
+    std::atomic<size_t> remaining{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done{false};
+    std::atomic<bool> failed{false};  // a call threw: the calls not yet started are skipped
+    std::exception_ptr error;          // the first exception thrown, guarded by mutex
+};
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < threadCount; ++i) {
+        m_Queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (unsigned i = 0; i < threadCount; ++i) {
+        m_Workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_Stop = true;
+    }
+    m_WakeUp.notify_all();
+    for (auto& worker : m_Workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn, const std::atomic<bool>* cancel)
+{
+    if (count == 0) {
+        return;
+    }
+    if (count == 1) {
+        fn(0);
+        return;
+    }
+
+    Batch batch;
+    batch.fn = &fn;
+    batch.remaining = count;
+
+    // Hand out contiguous index ranges so neighbouring tiles start on the same
+    // worker; stealing rebalances whatever ends up uneven.
+    const size_t queueCount = m_Queues.size();
+    const unsigned first = m_NextQueue.fetch_add(1) % static_cast<unsigned>(queueCount);
+    const bool nested = tl_Pool == this;
+    for (size_t q = 0; q < queueCount; ++q) {
+        size_t begin = count * q / queueCount;
+        size_t end = count * (q + 1) / queueCount;
+        if (begin == end) {
+            continue;
+        }
+        WorkerQueue& queue = *m_Queues[(first + q) % queueCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        for (size_t i = begin; i < end; ++i) {
+            queue.tasks.push_back({&batch, i, nested});
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_Pending += count;
+    }
+    m_WakeUp.notify_all();
+
+    if (nested) {
+        // Nested call from a worker: keep working rather than blocking a thread.
+        Task task;
+        while (batch.remaining.load() > 0) {
+            if (cancel && cancel->load()) {
+                withdraw(batch);
+                break;
+            }
+            if (popTask(tl_WorkerIndex, task)) {
+                runTask(task);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    if (!cancel) {
+        batch.finished.wait(lock, [&batch] { return batch.done; });
+    } else {
+        // Nothing signals the cancel flag, so it is polled while waiting.
+        while (!batch.finished.wait_for(lock, std::chrono::milliseconds(kCancelPollMs),
+                                        [&batch] { return batch.done; })) {
+            if (cancel->load()) {
+                lock.unlock();
+                withdraw(batch);
+                lock.lock();
+                batch.finished.wait(lock, [&batch] { return batch.done; });
+                break;
+            }
+        }
+    }
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+void ThreadPool::workerLoop(unsigned self)
+{
+    tl_Pool = this;
+    tl_WorkerIndex = self;
+
+    Task task;
+    while (true) {
+        if (popTask(self, task)) {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_SleepMutex);
+        m_WakeUp.wait(lock, [this] { return m_Stop || m_Pending.load() > 0; });
+        if (m_Stop && m_Pending.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::popTask(unsigned self, Task& out)
+{
+    const size_t queueCount = m_Queues.size();
+
+    // Own queue first. Nested tasks are LIFO, so the innermost parallelFor
+    // finishes first and keeps its data warm; batches from outside the pool
+    // run oldest first, so with several callers none of them is starved by
+    // the batches queued after it.
+    {
+        WorkerQueue& own = *m_Queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            if (own.tasks.back().nested) {
+                out = own.tasks.back();
+                own.tasks.pop_back();
+            } else {
+                out = own.tasks.front();
+                own.tasks.pop_front();
+            }
+            --m_Pending;
+            return true;
+        }
+    }
+
+    // ... then steal the oldest task of a victim.
+    for (size_t i = 1; i < queueCount; ++i) {
+        WorkerQueue& victim = *m_Queues[(self + i) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            out = victim.tasks.front();
+            victim.tasks.pop_front();
+            --m_Pending;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::withdraw(Batch& batch)
+{
+    size_t removed = 0;
+    for (auto& queue : m_Queues) {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        const auto end = std::remove_if(queue->tasks.begin(), queue->tasks.end(),
+                                        [&batch](const Task& task) { return task.batch == &batch; });
+        removed += static_cast<size_t>(queue->tasks.end() - end);
+        queue->tasks.erase(end, queue->tasks.end());
+    }
+    if (removed == 0) {
+        return;
+    }
+    m_Pending -= removed;
+    if (batch.remaining.fetch_sub(removed) == removed) {
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        batch.done = true;
+        batch.finished.notify_all();
+    }
+}
+
+void ThreadPool::runTask(const Task& task)
+{
+    Batch* batch = task.batch;
+    if (!batch->failed.load()) {
+        try {
+            (*batch->fn)(task.index);
+        } catch (...) {
+            // Kept for parallelFor to rethrow on its caller's thread; a
+            // worker that let it escape would terminate the process.
+            {
+                std::lock_guard<std::mutex> lock(batch->mutex);
+                if (!batch->error) {
+                    batch->error = std::current_exception();
+                }
+            }
+            batch->failed = true;
+            withdraw(*batch);
+        }
+    }
+    if (batch->remaining.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        batch->done = true;
+        batch->finished.notify_all();
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent work-stealing thread pool.
+// Every worker owns a deque: it takes its own work in submission order, and
+// nested work (queued from inside a task) most recent first; when its deque
+// is empty it steals from the front of the other workers' deques.
+class ThreadPool {
+  public:
+    explicit ThreadPool(unsigned threadCount = 0);  // 0 = hardware concurrency
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(m_Workers.size()); }
+
+    // Runs fn(i) for every i in [0, count) and blocks until all calls returned.
+    // May be called from several threads at once and from inside a task.
+    // Once *cancel is set, the calls not yet started are dropped from the
+    // queues and it returns as soon as the running ones are done. When a call
+    // throws, the calls not yet started are dropped the same way and the first
+    // exception is rethrown here once the running ones are done.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn,
+                     const std::atomic<bool>* cancel = nullptr);
+
+  private:
+    struct Batch;
+
+    struct Task {
+        Batch* batch{nullptr};
+        size_t index{0};
+        bool nested{false};  // queued by parallelFor on one of the workers
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(unsigned self);
+    bool popTask(unsigned self, Task& out);
+    void runTask(const Task& task);
+    // Removes the queued tasks of batch, which then only waits for its running ones.
+    // Also called from a running task of batch, whose own count it leaves alone.
+    void withdraw(Batch& batch);
+
+  private:
+    std::vector<std::unique_ptr<WorkerQueue>> m_Queues;
+    std::vector<std::thread> m_Workers;
+    std::mutex m_SleepMutex;
+    std::condition_variable m_WakeUp;
+    std::atomic<size_t> m_Pending{0};
+    std::atomic<unsigned> m_NextQueue{0};
+    bool m_Stop{false};
+};
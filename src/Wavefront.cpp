@@ -0,0 +1,359 @@
+#include <Wavefront.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+const char* wavefrontStageName(WavefrontStage stage)
+{
+    switch (stage) {
+        case WavefrontStage::Generate:
+            return "generate";
+        case WavefrontStage::ClosestHit:
+            return "closest-hit";
+        case WavefrontStage::Shade:
+            return "shade";
+        case WavefrontStage::Shadow:
+            return "shadow";
+        case WavefrontStage::Reflection:
+            return "reflection";
+        case WavefrontStage::Refraction:
+            return "refraction";
+        default:
+            return "?";
+    }
+}
+
+void WavefrontStats::add(WavefrontStage stage, double elapsed, uint64_t count)
+{
+    seconds[static_cast<int>(stage)] += elapsed;
+    items[static_cast<int>(stage)] += count;
+}
+
+void WavefrontStats::merge(const WavefrontStats& other)
+{
+    for (int i = 0; i < kWavefrontStageCount; ++i) {
+        seconds[i] += other.seconds[i];
+        items[i] += other.items[i];
+    }
+}
+
+void RayQueue::clear()
+{
+    originX.clear();
+    originY.clear();
+    originZ.clear();
+    dirX.clear();
+    dirY.clear();
+    dirZ.clear();
+    pixel.clear();
+}
+
+void RayQueue::reserve(size_t count)
+{
+    originX.reserve(count);
+    originY.reserve(count);
+    originZ.reserve(count);
+    dirX.reserve(count);
+    dirY.reserve(count);
+    dirZ.reserve(count);
+    pixel.reserve(count);
+}
+
+void RayQueue::push(const Ray& ray, uint32_t pixelSlot)
+{
+    originX.push_back(ray.origin.x);
+    originY.push_back(ray.origin.y);
+    originZ.push_back(ray.origin.z);
+    dirX.push_back(ray.direction.x);
+    dirY.push_back(ray.direction.y);
+    dirZ.push_back(ray.direction.z);
+    pixel.push_back(pixelSlot);
+}
+
+Ray RayQueue::ray(size_t i) const
+{
+    return {{originX[i], originY[i], originZ[i]}, {dirX[i], dirY[i], dirZ[i]}};
+}
+
+void WavefrontTracer::ShadowQueue::clear()
+{
+    originX.clear();
+    originY.clear();
+    originZ.clear();
+    dirX.clear();
+    dirY.clear();
+    dirZ.clear();
+    tMax.clear();
+    shadePoint.clear();
+    light.clear();
+    occluded.clear();
+}
+
+WavefrontTracer::WavefrontTracer(const CompiledScene& scene, const KernelTable& kernels, const WavefrontOptions& options)
+    : m_Scene(scene), m_Kernels(kernels), m_Options(options)
+{}
+
+void WavefrontTracer::trace(RayQueue& rays, glm::vec3* colors, OccluderCache& cache, WavefrontStats& stats)
+{
+    const GeometryView& geo = m_Scene.geometryView();
+
+    // Depth d may still be traced; the bounce rays it spawns are dropped
+    // (black) past maxDepth, like trace(ray, depth > m_MaxDepth).
+    for (int depth = 0; !rays.empty() && depth <= m_Options.maxDepth; ++depth) {
+        Clock::time_point start = Clock::now();
+        closestHitStage(rays);
+        m_OpaqueHits.clear();
+        m_ReflectiveHits.clear();
+        m_TransparentHits.clear();
+        for (uint32_t i = 0; i < rays.size(); ++i) {
+            if (m_HitPrim[i].kind == PrimitiveKind::None) {
+                continue;  // background stays black
+            }
+            switch (m_Scene.material(geo.materialIndex(m_HitPrim[i])).type) {
+                case ObjectType::Reflective:
+                    m_ReflectiveHits.push_back(i);
+                    break;
+                case ObjectType::Transparent:
+                    m_TransparentHits.push_back(i);
+                    break;
+                case ObjectType::Opaque:
+                default:
+                    m_OpaqueHits.push_back(i);
+                    break;
+            }
+        }
+        stats.add(WavefrontStage::ClosestHit, secondsSince(start), rays.size());
+
+        start = Clock::now();
+        shadeStage(rays);
+        double shadeSeconds = secondsSince(start);
+
+        start = Clock::now();
+        shadowStage(cache);
+        stats.add(WavefrontStage::Shadow, secondsSince(start), m_Shadows.size());
+
+        start = Clock::now();
+        resolveShading(colors);
+        stats.add(WavefrontStage::Shade, shadeSeconds + secondsSince(start), m_ShadePoints.size());
+
+        m_NextRays.clear();
+        start = Clock::now();
+        reflectionStage(rays);
+        stats.add(WavefrontStage::Reflection, secondsSince(start), m_ReflectiveHits.size());
+
+        start = Clock::now();
+        refractionStage(rays);
+        stats.add(WavefrontStage::Refraction, secondsSince(start), m_TransparentHits.size());
+
+        std::swap(rays, m_NextRays);
+    }
+    rays.clear();
+}
+
+void WavefrontTracer::closestHitStage(const RayQueue& rays)
+{
+    const size_t count = rays.size();
+    m_HitT.resize(count);
+    m_HitPrim.resize(count);
+
+    const int width = m_Options.packetWidth;
+    if (width == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            const float origin[3] = {rays.originX[i], rays.originY[i], rays.originZ[i]};
+            const float dir[3] = {rays.dirX[i], rays.dirY[i], rays.dirZ[i]};
+            ScalarHit hit;
+            bool found = m_Kernels.closestHit(m_Scene.geometryView(), origin, dir, m_Options.epsilon, kMaxDistance,
+                                              hit);
+            m_HitT[i] = hit.t;
+            m_HitPrim[i] = found ? PrimitiveRef{static_cast<PrimitiveKind>(hit.kind), hit.index} : PrimitiveRef{};
+        }
+        return;
+    }
+
+    ClosestHitPacketFn query = width == 8 ? m_Kernels.closestHitPacket8 : m_Kernels.closestHitPacket4;
+    RayPacket packet;
+    PacketHits hits;
+    for (size_t first = 0; first < count; first += width) {
+        int lanes = static_cast<int>(std::min<size_t>(width, count - first));
+        packet.activeMask = (1u << lanes) - 1u;
+        for (int lane = 0; lane < width; ++lane) {
+            // Idle lanes replay the first ray so they never feed garbage to the math.
+            size_t i = first + (lane < lanes ? lane : 0);
+            packet.originX[lane] = rays.originX[i];
+            packet.originY[lane] = rays.originY[i];
+            packet.originZ[lane] = rays.originZ[i];
+            packet.dirX[lane] = rays.dirX[i];
+            packet.dirY[lane] = rays.dirY[i];
+            packet.dirZ[lane] = rays.dirZ[i];
+        }
+        query(m_Scene.geometryView(), packet, m_Options.epsilon, kMaxDistance, hits);
+        for (int lane = 0; lane < lanes; ++lane) {
+            m_HitT[first + lane] = hits.t[lane];
+            m_HitPrim[first + lane] = hits.order[lane] < 0
+                ? PrimitiveRef{}
+                : PrimitiveRef{static_cast<PrimitiveKind>(hits.kind[lane]), hits.index[lane]};
+        }
+    }
+}
+
+Ray WavefrontTracer::hitRay(const RayQueue& rays, uint32_t i, glm::vec3& point, glm::vec3& normal) const
+{
+    // Same attributes as RayTracer::fillHit.
+    const GeometryView& geo = m_Scene.geometryView();
+    Ray ray = rays.ray(i);
+    PrimitiveRef prim = m_HitPrim[i];
+    point = ray.origin + m_HitT[i] * ray.direction;
+    if (prim.kind == PrimitiveKind::Sphere) {
+        normal = glm::normalize(point - geo.sphereCenter(prim.index));
+    } else {
+        normal = geo.planeNormal(prim.index);
+    }
+    return ray;
+}
+
+void WavefrontTracer::shadeStage(const RayQueue& rays)
+{
+    const GeometryView& geo = m_Scene.geometryView();
+    const LightView& lights = m_Scene.lightView();
+    const float eps = m_Options.epsilon;
+
+    m_ShadePoints.clear();
+    m_Shadows.clear();
+    for (uint32_t i : m_OpaqueHits) {
+        ShadePoint sp;
+        Ray ray = hitRay(rays, i, sp.point, sp.normal);
+        if (glm::dot(ray.direction, sp.normal) > 0.0f) {
+            sp.normal = -sp.normal;
+        }
+        PrimitiveRef prim = m_HitPrim[i];
+        sp.material = geo.materialIndex(prim);
+        const Material& mat = m_Scene.material(sp.material);
+        sp.baseColor = prim.kind == PrimitiveKind::Plane ? checkerboardColor(mat.diffuse, sp.point) : mat.diffuse;
+        sp.color = mat.ambient * m_Scene.ambient();
+        sp.viewDir = glm::normalize(m_Options.eye - sp.point);
+        sp.pixel = rays.pixel[i];
+
+        // Light setup of the Phong kernel: spot cone test and the direction and
+        // length of the shadow ray, in the kernel's operation order.
+        const uint32_t shadePoint = static_cast<uint32_t>(m_ShadePoints.size());
+        const float* p = &sp.point.x;
+        for (uint32_t k = 0; k < lights.count; ++k) {
+            float L[3];
+            float maxDist = kMaxDistance;
+            if (lights.isSpot[k]) {
+                float toLight[3] = {lights.posX[k] - p[0], lights.posY[k] - p[1], lights.posZ[k] - p[2]};
+                maxDist = std::sqrt(toLight[0] * toLight[0] + toLight[1] * toLight[1] + toLight[2] * toLight[2]);
+                if (maxDist <= 0.0f) {
+                    continue;
+                }
+                L[0] = toLight[0] / maxDist;
+                L[1] = toLight[1] / maxDist;
+                L[2] = toLight[2] / maxDist;
+
+                float spotCos = lights.dirX[k] * -L[0] + lights.dirY[k] * -L[1] + lights.dirZ[k] * -L[2];
+                if (spotCos < lights.cutoff[k]) {
+                    continue;
+                }
+            } else {
+                L[0] = lights.dirX[k];
+                L[1] = lights.dirY[k];
+                L[2] = lights.dirZ[k];
+            }
+
+            m_Shadows.originX.push_back(p[0] + L[0] * eps);
+            m_Shadows.originY.push_back(p[1] + L[1] * eps);
+            m_Shadows.originZ.push_back(p[2] + L[2] * eps);
+            m_Shadows.dirX.push_back(L[0]);
+            m_Shadows.dirY.push_back(L[1]);
+            m_Shadows.dirZ.push_back(L[2]);
+            m_Shadows.tMax.push_back(maxDist - eps);
+            m_Shadows.shadePoint.push_back(shadePoint);
+            m_Shadows.light.push_back(k);
+        }
+        m_ShadePoints.push_back(sp);
+    }
+}
+
+void WavefrontTracer::shadowStage(OccluderCache& cache)
+{
+    const size_t count = m_Shadows.size();
+    m_Shadows.occluded.resize(count);
+    for (size_t s = 0; s < count; ++s) {
+        const float origin[3] = {m_Shadows.originX[s], m_Shadows.originY[s], m_Shadows.originZ[s]};
+        const float dir[3] = {m_Shadows.dirX[s], m_Shadows.dirY[s], m_Shadows.dirZ[s]};
+        // The shaded primitive never shadows itself.
+        PrimitiveRef ignore = m_HitPrim[m_OpaqueHits[m_Shadows.shadePoint[s]]];
+        m_Shadows.occluded[s] = m_Kernels.occluded(m_Scene.geometryView(), origin, dir, m_Options.epsilon,
+                                                          m_Shadows.tMax[s], static_cast<uint32_t>(ignore.kind),
+                                                          ignore.index, &cache, m_Shadows.light[s]);
+    }
+}
+
+void WavefrontTracer::resolveShading(glm::vec3* colors)
+{
+    const LightView& lights = m_Scene.lightView();
+    for (size_t s = 0; s < m_Shadows.size(); ++s) {
+        if (m_Shadows.occluded[s]) {
+            continue;
+        }
+        ShadePoint& sp = m_ShadePoints[m_Shadows.shadePoint[s]];
+        const Material& mat = m_Scene.material(sp.material);
+        const uint32_t k = m_Shadows.light[s];
+        const float L[3] = {m_Shadows.dirX[s], m_Shadows.dirY[s], m_Shadows.dirZ[s]};
+        const float* n = &sp.normal.x;
+        const float* v = &sp.viewDir.x;
+
+        float diff = n[0] * L[0] + n[1] * L[1] + n[2] * L[2];
+        diff = diff < 0.0f ? 0.0f : diff;
+
+        // glm::reflect(-L, n) = I - n * dot(n, I) * 2
+        float I[3] = {-L[0], -L[1], -L[2]};
+        float nDotI = n[0] * I[0] + n[1] * I[1] + n[2] * I[2];
+        float r[3] = {I[0] - n[0] * nDotI * 2.0f, I[1] - n[1] * nDotI * 2.0f, I[2] - n[2] * nDotI * 2.0f};
+        float vDotR = v[0] * r[0] + v[1] * r[1] + v[2] * r[2];
+        float spec = std::pow(vDotR < 0.0f ? 0.0f : vDotR, mat.shininess);
+
+        const float intensity[3] = {lights.intensityR[k], lights.intensityG[k], lights.intensityB[k]};
+        for (int c = 0; c < 3; ++c) {
+            float diffuse = sp.baseColor[c] * intensity[c] * diff;
+            float specular = mat.specular[c] * intensity[c] * spec;
+            sp.color[c] += diffuse + specular;
+        }
+    }
+
+    for (const ShadePoint& sp : m_ShadePoints) {
+        colors[sp.pixel] = sp.color;  // unclamped: the post stage tone-maps
+    }
+}
+
+void WavefrontTracer::reflectionStage(const RayQueue& rays)
+{
+    for (uint32_t i : m_ReflectiveHits) {
+        glm::vec3 point;
+        glm::vec3 normal;
+        Ray ray = hitRay(rays, i, point, normal);
+        m_NextRays.push(reflectedRay(ray, point, normal, m_Options.epsilon), rays.pixel[i]);
+    }
+}
+
+void WavefrontTracer::refractionStage(const RayQueue& rays)
+{
+    for (uint32_t i : m_TransparentHits) {
+        glm::vec3 point;
+        glm::vec3 normal;
+        Ray ray = hitRay(rays, i, point, normal);
+        m_NextRays.push(refractedRay(m_Scene.geometryView(), m_HitPrim[i], ray, point, normal, m_Options.epsilon),
+                        rays.pixel[i]);
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <CompiledScene.h>
+#include <Geometry.h>
+#include <Kernels.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Queue-based alternative to RayTracer::trace. A tile's camera rays are put in
+// one queue and advanced a bounce at a time: every stage runs over the whole
+// batch of structure-of-arrays rays instead of following one path to its end.
+// The math of each stage repeats the recursive path, so the images match it.
+
+enum class WavefrontStage {
+    Generate,
+    ClosestHit,
+    Shade,
+    Shadow,
+    Reflection,
+    Refraction,
+    Count
+};
+
+constexpr int kWavefrontStageCount = static_cast<int>(WavefrontStage::Count);
+
+const char* wavefrontStageName(WavefrontStage stage);
+
+// Time spent in each stage and the rays (or hits) it processed, summed over
+// tiles and therefore over threads.
+struct WavefrontStats {
+    std::array<double, kWavefrontStageCount> seconds{};
+    std::array<uint64_t, kWavefrontStageCount> items{};
+
+    void add(WavefrontStage stage, double elapsed, uint64_t count);
+    void merge(const WavefrontStats& other);
+};
+
+struct RayQueue {
+    std::vector<float> originX;
+    std::vector<float> originY;
+    std::vector<float> originZ;
+    std::vector<float> dirX;
+    std::vector<float> dirY;
+    std::vector<float> dirZ;
+    std::vector<uint32_t> pixel;  // slot in the caller's color buffer
+
+    size_t size() const { return pixel.size(); }
+    bool empty() const { return pixel.empty(); }
+    void clear();
+    void reserve(size_t count);
+    void push(const Ray& ray, uint32_t pixelSlot);
+    Ray ray(size_t i) const;
+};
+
+struct WavefrontOptions {
+    float epsilon{1e-4f};
+    int maxDepth{5};
+    int packetWidth{1};  // 1 = scalar closest-hit queries
+    glm::vec3 eye{0.0f}; // camera position, the view point of the specular term
+};
+
+class WavefrontTracer {
+  public:
+    WavefrontTracer(const CompiledScene& scene, const KernelTable& kernels, const WavefrontOptions& options);
+
+    // Traces every ray in rays (left empty on return). colors[pixel] receives the
+    // color of each path that ends on an opaque surface; other slots are untouched.
+    void trace(RayQueue& rays, glm::vec3* colors, OccluderCache& cache, WavefrontStats& stats);
+
+  private:
+    struct ShadePoint {
+        glm::vec3 point;
+        glm::vec3 normal;  // facing the incoming ray
+        glm::vec3 viewDir;
+        glm::vec3 baseColor;
+        glm::vec3 color;    // ambient term, then the lit contributions
+        uint32_t material;  // index into SceneGeometry::materials
+        uint32_t pixel;
+    };
+
+    // Shadow rays are grouped by shade point and ordered by light, so the
+    // contributions are summed in the same order as the recursive shade().
+    struct ShadowQueue {
+        std::vector<float> originX;
+        std::vector<float> originY;
+        std::vector<float> originZ;
+        std::vector<float> dirX;
+        std::vector<float> dirY;
+        std::vector<float> dirZ;
+        std::vector<float> tMax;
+        std::vector<uint32_t> shadePoint;
+        std::vector<uint32_t> light;
+        std::vector<uint8_t> occluded;
+
+        size_t size() const { return shadePoint.size(); }
+        void clear();
+    };
+
+    void closestHitStage(const RayQueue& rays);
+    void shadeStage(const RayQueue& rays);
+    void shadowStage(OccluderCache& cache);
+    void resolveShading(glm::vec3* colors);
+    void reflectionStage(const RayQueue& rays);
+    void refractionStage(const RayQueue& rays);
+
+    Ray hitRay(const RayQueue& rays, uint32_t i, glm::vec3& point, glm::vec3& normal) const;
+
+    const CompiledScene& m_Scene;
+    const KernelTable& m_Kernels;
+    WavefrontOptions m_Options;
+
+    // Per bounce: closest hit of every queued ray, then the rays split by material.
+    std::vector<float> m_HitT;
+    std::vector<PrimitiveRef> m_HitPrim;
+    std::vector<uint32_t> m_OpaqueHits;
+    std::vector<uint32_t> m_ReflectiveHits;
+    std::vector<uint32_t> m_TransparentHits;
+
+    std::vector<ShadePoint> m_ShadePoints;
+    ShadowQueue m_Shadows;
+    RayQueue m_NextRays;
+};